@@ -0,0 +1,11 @@
+/**
+ * @file graphics/bounds_fragment_shader.glsl
+ * @brief Fragment shader for chunk bounding boxes. Color and depth writes are off while
+ *        the boxes are drawn, only whether a fragment passes the depth test matters.
+ * @author frankischilling
+ * @date 2024-12-16
+ */
+#version 330 core
+
+void main() {
+}
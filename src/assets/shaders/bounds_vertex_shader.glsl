@@ -0,0 +1,25 @@
+/**
+ * @file graphics/bounds_vertex_shader.glsl
+ * @brief Vertex shader for chunk bounding boxes drawn by occlusion queries. Scales and moves
+ *        a unit cube onto the box with the model matrix, nothing is passed to the fragment shader.
+ * @author frankischilling
+ * @date 2024-12-16
+ */
+#version 330 core
+
+layout (location = 0) in vec3 aPos; // Unit cube corner, -0.5 to 0.5
+
+uniform mat4 model; // Box center and size
+
+// Per frame camera and light data shared by every program, see FrameUniforms in shader.h
+layout (std140) uniform Frame {
+    mat4 view;        // View matrix
+    mat4 projection;  // Projection matrix
+    vec4 viewPos;     // Camera position for specular calculation
+    vec4 lightPos;    // Position of the light source
+    vec4 lightColor;  // Color of the light source
+};
+
+void main() {
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
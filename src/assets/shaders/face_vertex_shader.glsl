@@ -0,0 +1,64 @@
+/**
+ * @file graphics/face_vertex_shader.glsl
+ * @brief Vertex shader for chunk meshes stored as face records. Pulls the record of the quad
+ *        gl_VertexID belongs to from a buffer texture and expands it with the cube face table.
+ * @author frankischilling
+ * @date 2024-12-14
+ */
+#version 330 core
+#extension GL_ARB_separate_shader_objects : enable
+
+uniform usamplerBuffer faces; // Face records of every chunk in the mesh arena, see FaceRecord
+uniform vec3 cornerPositions[36]; // Cube face table positions in 0..1, 6 corners per face
+uniform vec2 cornerTexCoords[36]; // Cube face table texture coordinates
+
+uniform samplerBuffer chunkPages; // World origin of the chunk owning each page of the mesh arena
+
+// Per frame camera and light data shared by every program, see FrameUniforms in shader.h
+layout (std140) uniform Frame {
+    mat4 view;        // View matrix
+    mat4 projection;  // Projection matrix
+    vec4 viewPos;     // Camera position for specular calculation
+    vec4 lightPos;    // Position of the light source
+    vec4 lightColor;  // Color of the light source
+};
+
+out vec3 FragPos; // Fragment position in world space
+out vec3 Normal; // Surface normal at fragment
+out vec2 TexCoord; // Texture coordinates
+flat out float TexLayer; // Texture array layer, constant across a face
+out float Occlusion; // Light left by ambient occlusion, 1 for a fully lit corner
+
+const int pageSize = 128; // Arena elements per page, same as MESH_PAGE_SIZE in mesh.h
+
+// Face normals in enum Face order
+const vec3 faceNormals[6] = vec3[6](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                    vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
+// Axes the texture u and v coordinates run along for each face, same as faceTextureAxes in mesh.c
+const ivec2 faceTextureAxes[6] = ivec2[6](ivec2(2, 1), ivec2(2, 1), ivec2(0, 2), ivec2(0, 2), ivec2(0, 1), ivec2(0, 1));
+
+void main() {
+    uvec2 record = texelFetch(faces, gl_VertexID / 6).xy;
+    uint face = (record.x >> 17u) & 7u;
+    int corner = int(face) * 6 + gl_VertexID % 6;
+
+    vec3 origin = vec3(float(record.x & 31u), float((record.x >> 5u) & 127u), float((record.x >> 12u) & 31u));
+    vec3 size = vec3(float((record.y & 15u) + 1u), float(((record.y >> 4u) & 63u) + 1u), float(((record.y >> 10u) & 15u) + 1u));
+    vec3 localPos = origin + cornerPositions[corner] * size;
+
+    // Chunks are only translated, normals need no transform
+    FragPos = localPos + texelFetch(chunkPages, gl_VertexID / 6 / pageSize).xyz;
+    Normal = faceNormals[face];
+    ivec2 axes = faceTextureAxes[face];
+    TexCoord = cornerTexCoords[corner] * vec2(size[axes.x], size[axes.y]);
+    TexLayer = float((record.y >> 14u) & 255u);
+
+    // Corner index of this vertex in the face plane, numbered like QUAD_AO_OPEN in mesh.h
+    vec3 cornerPosition = cornerPositions[corner];
+    int planeAxis0 = face / 2u == 0u ? 1 : 0;
+    int planeAxis1 = face / 2u == 2u ? 1 : 2;
+    int aoCorner = int(cornerPosition[planeAxis0] > 0.5) | int(cornerPosition[planeAxis1] > 0.5) << 1;
+    Occlusion = 0.4 + 0.2 * float((record.x >> (20u + 2u * uint(aoCorner))) & 3u);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
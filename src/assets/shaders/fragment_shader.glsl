@@ -12,31 +12,38 @@ out vec4 FragColor;
 in vec3 FragPos;  // Fragment position in world space
 in vec3 Normal;   // Surface normal at fragment
 in vec2 TexCoord; // Texture coordinates
+flat in float TexLayer; // Texture array layer
+in float Occlusion; // Ambient occlusion, darkens corners closed in by blocks
 
-uniform vec3 lightPos;    // Position of the light source
-uniform vec3 viewPos;     // Camera position for specular calculation
-uniform vec3 lightColor;  // Color of the light source
-uniform sampler2D texture1; // Texture sampler
+// Per frame camera and light data shared by every program, see FrameUniforms in shader.h
+layout (std140) uniform Frame {
+    mat4 view;        // View matrix
+    mat4 projection;  // Projection matrix
+    vec4 viewPos;     // Camera position for specular calculation
+    vec4 lightPos;    // Position of the light source
+    vec4 lightColor;  // Color of the light source
+};
+uniform sampler2DArray blockTextures; // One layer per block texture
 
 void main() {
     // Calculate ambient lighting component
     float ambientStrength = 0.2;
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = ambientStrength * lightColor.xyz;
 
     // Calculate diffuse lighting component
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(lightPos - FragPos);
+    vec3 lightDir = normalize(lightPos.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = diff * lightColor.xyz;
 
     // Calculate specular lighting component
     float specularStrength = 0.5;
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPos.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-    vec3 specular = specularStrength * spec * lightColor;
+    vec3 specular = specularStrength * spec * lightColor.xyz;
 
     // Combine all lighting components and apply texture color
-    vec3 result = (ambient + diffuse + specular) * texture(texture1, TexCoord).rgb;
+    vec3 result = (ambient + diffuse + specular) * Occlusion * texture(blockTextures, vec3(TexCoord, TexLayer)).rgb;
     FragColor = vec4(result, 1.0);
 }
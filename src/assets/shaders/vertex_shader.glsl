@@ -12,18 +12,31 @@
 layout (location = 0) in vec3 aPos; // Vertex position
 layout (location = 1) in vec3 aNormal; // Vertex normal
 layout (location = 2) in vec2 aTexCoord; // Texture coordinates
+layout (location = 3) in float aTexLayer; // Layer of the block texture array
 
 uniform mat4 model; // Model matrix
-uniform mat4 view; // View matrix
-uniform mat4 projection; // Projection matrix
+uniform mat3 normalMatrix; // Inverse transpose of the model matrix, computed on the CPU
+
+// Per frame camera and light data shared by every program, see FrameUniforms in shader.h
+layout (std140) uniform Frame {
+    mat4 view;        // View matrix
+    mat4 projection;  // Projection matrix
+    vec4 viewPos;     // Camera position for specular calculation
+    vec4 lightPos;    // Position of the light source
+    vec4 lightColor;  // Color of the light source
+};
 
 out vec3 FragPos; // Fragment position in world space
 out vec3 Normal; // Surface normal at fragment
 out vec2 TexCoord; // Texture coordinates
+flat out float TexLayer; // Texture array layer, constant across a face
+out float Occlusion; // Light left by ambient occlusion, always 1 here
 
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0)); // Transform vertex position to world space
-    Normal = mat3(transpose(inverse(model))) * aNormal; // Transform normal to world space
+    Normal = normalMatrix * aNormal; // Transform normal to world space
     TexCoord = aTexCoord; // Pass texture coordinates to fragment shader
-    gl_Position = projection * view * model * vec4(aPos, 1.0); // Transform vertex position to clip space
+    TexLayer = aTexLayer;
+    Occlusion = 1.0;
+    gl_Position = projection * view * vec4(FragPos, 1.0); // Transform vertex position to clip space
 }
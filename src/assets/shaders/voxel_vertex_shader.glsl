@@ -0,0 +1,51 @@
+/**
+ * @file graphics/voxel_vertex_shader.glsl
+ * @brief Vertex shader for chunk meshes. Unpacks the two word vertices built in world/mesh.c
+ *        and feeds the same Phong lighting inputs as vertex_shader.glsl.
+ * @author frankischilling
+ * @date 2024-12-13
+ */
+#version 330 core
+#extension GL_ARB_separate_shader_objects : enable
+
+layout (location = 0) in uvec2 aPacked; // Packed position and texture words, see MeshVertex
+
+uniform samplerBuffer chunkPages; // World origin of the chunk owning each page of the mesh arena
+
+// Per frame camera and light data shared by every program, see FrameUniforms in shader.h
+layout (std140) uniform Frame {
+    mat4 view;        // View matrix
+    mat4 projection;  // Projection matrix
+    vec4 viewPos;     // Camera position for specular calculation
+    vec4 lightPos;    // Position of the light source
+    vec4 lightColor;  // Color of the light source
+};
+
+out vec3 FragPos; // Fragment position in world space
+out vec3 Normal; // Surface normal at fragment
+out vec2 TexCoord; // Texture coordinates
+flat out float TexLayer; // Texture array layer, constant across a face
+out float Occlusion; // Light left by ambient occlusion, 1 for a fully lit corner
+
+const int pageSize = 128; // Arena elements per page, same as MESH_PAGE_SIZE in mesh.h
+
+// Face normals in enum Face order
+const vec3 faceNormals[6] = vec3[6](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                    vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
+void main() {
+    uint packedPosition = aPacked.x;
+    uint packedTexture = aPacked.y;
+
+    vec3 localPos = vec3(float(packedPosition & 31u), float((packedPosition >> 5u) & 127u), float((packedPosition >> 12u) & 31u));
+    uint face = (packedPosition >> 17u) & 7u;
+    uint ao = (packedPosition >> 20u) & 3u;
+
+    // Chunks are only translated, normals need no transform
+    FragPos = localPos + texelFetch(chunkPages, gl_VertexID / pageSize).xyz;
+    Normal = faceNormals[face];
+    TexCoord = vec2(float(packedTexture & 127u), float((packedTexture >> 7u) & 127u));
+    TexLayer = float((packedTexture >> 14u) & 255u);
+    Occlusion = 0.4 + 0.2 * float(ao);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,260 @@
+/**
+ * @file graphics/arena.c
+ * @brief One large GPU buffer shared by many meshes, handed out in ranges.
+ * @author frankischilling
+ * @date 2024-12-15
+ */
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ARENA_COMPACT_FREE_RANGES 256 // Free ranges after which holes get packed away
+
+static GLuint createBuffer(int capacity, int elementSize) {
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * elementSize, NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return buffer;
+}
+
+static bool reserveFreeRanges(GpuArena* arena, int count) {
+  if (count <= arena->freeCapacity) {
+    return true;
+  }
+  int capacity = arena->freeCapacity ? arena->freeCapacity * 2 : 64;
+  while (capacity < count) {
+    capacity *= 2;
+  }
+  GpuFreeRange* ranges = (GpuFreeRange*)realloc(arena->freeRanges, capacity * sizeof(GpuFreeRange));
+  if (!ranges) {
+    fprintf(stderr, "Failed to grow GPU arena free list to %d ranges\n", capacity);
+    return false;
+  }
+  arena->freeRanges = ranges;
+  arena->freeCapacity = capacity;
+  return true;
+}
+
+// Return elements to the free list, merging with the free ranges on either side.
+static void insertFreeRange(GpuArena* arena, int offset, int count) {
+  int i = 0;
+  while (i < arena->freeCount && arena->freeRanges[i].offset < offset) {
+    i++;
+  }
+
+  bool mergePrevious = i > 0 && arena->freeRanges[i - 1].offset + arena->freeRanges[i - 1].count == offset;
+  bool mergeNext = i < arena->freeCount && offset + count == arena->freeRanges[i].offset;
+  if (mergePrevious && mergeNext) {
+    arena->freeRanges[i - 1].count += count + arena->freeRanges[i].count;
+    arena->freeCount--;
+    for (int j = i; j < arena->freeCount; j++) {
+      arena->freeRanges[j] = arena->freeRanges[j + 1];
+    }
+  } else if (mergePrevious) {
+    arena->freeRanges[i - 1].count += count;
+  } else if (mergeNext) {
+    arena->freeRanges[i].offset = offset;
+    arena->freeRanges[i].count += count;
+  } else {
+    if (!reserveFreeRanges(arena, arena->freeCount + 1)) {
+      return; // The elements leak until the next compaction
+    }
+    for (int j = arena->freeCount; j > i; j--) {
+      arena->freeRanges[j] = arena->freeRanges[j - 1];
+    }
+    arena->freeRanges[i] = (GpuFreeRange){offset, count};
+    arena->freeCount++;
+  }
+}
+
+static int roundCount(const GpuArena* arena, int count) {
+  return (count + arena->granularity - 1) / arena->granularity * arena->granularity;
+}
+
+// Elements the arena holds back for the range, which is what stays unused by other ranges.
+int gpuArenaReservedCount(const GpuArena* arena, const GpuRange* range) {
+  return roundCount(arena, range->count);
+}
+
+static int compareRangeOffsets(const void* a, const void* b) {
+  const GpuRange* left = *(GpuRange* const*)a;
+  const GpuRange* right = *(GpuRange* const*)b;
+  return (left->offset > right->offset) - (left->offset < right->offset);
+}
+
+// Copy every live range to the front of a new buffer, in their current order, and leave
+// the rest of the buffer as one free range. Owners see their new offsets right away.
+static void relayoutArena(GpuArena* arena, int capacity) {
+  GLuint buffer = createBuffer(capacity, arena->elementSize);
+
+  qsort(arena->live, arena->liveCount, sizeof(GpuRange*), compareRangeOffsets);
+  glBindBuffer(GL_COPY_READ_BUFFER, arena->buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  int cursor = 0;
+  for (int i = 0; i < arena->liveCount; i++) {
+    GpuRange* range = arena->live[i];
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)range->offset * arena->elementSize, (GLintptr)cursor * arena->elementSize,
+                        (GLsizeiptr)range->count * arena->elementSize);
+    range->offset = cursor;
+    range->slot = i + 1;
+    cursor += roundCount(arena, range->count);
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  glDeleteBuffers(1, &arena->buffer);
+  arena->buffer = buffer;
+  arena->capacity = capacity;
+  arena->freeCount = 0;
+  if (cursor < capacity) {
+    arena->freeRanges[arena->freeCount++] = (GpuFreeRange){cursor, capacity - cursor};
+  }
+
+  if (arena->texture != 0) {
+    glBindTexture(GL_TEXTURE_BUFFER, arena->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, arena->textureFormat, arena->buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+  arena->generation++;
+  arena->compactions++;
+}
+
+// capacity is in elements and a multiple of granularity. With a texture format other than GL_NONE the
+// arena also keeps a buffer texture over its buffer, for shaders that fetch records instead of reading attributes.
+bool gpuArenaInit(GpuArena* arena, int elementSize, int granularity, GLenum textureFormat, int capacity) {
+  *arena = (GpuArena){0};
+  arena->elementSize = elementSize;
+  arena->granularity = granularity;
+  arena->textureFormat = textureFormat;
+  if (!reserveFreeRanges(arena, 1)) {
+    return false;
+  }
+  arena->buffer = createBuffer(capacity, elementSize);
+  arena->capacity = capacity;
+  arena->freeRanges[arena->freeCount++] = (GpuFreeRange){0, capacity};
+
+  if (textureFormat != GL_NONE) {
+    glGenTextures(1, &arena->texture);
+    glBindTexture(GL_TEXTURE_BUFFER, arena->texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, textureFormat, arena->buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+  }
+  return true;
+}
+
+void gpuArenaDestroy(GpuArena* arena) {
+  glDeleteBuffers(1, &arena->buffer);
+  if (arena->texture != 0) {
+    glDeleteTextures(1, &arena->texture);
+  }
+  for (int i = 0; i < arena->liveCount; i++) {
+    arena->live[i]->slot = 0;
+  }
+  free(arena->freeRanges);
+  free(arena->live);
+  *arena = (GpuArena){0};
+}
+
+// First fit allocation. Compacts, and grows the buffer when compaction alone leaves too little room.
+bool gpuArenaAlloc(GpuArena* arena, GpuRange* range, int count) {
+  *range = (GpuRange){0, count, 0};
+  if (count == 0) {
+    return true;
+  }
+  int reserved = roundCount(arena, count);
+
+  if (arena->liveCount == arena->liveCapacity) {
+    int capacity = arena->liveCapacity ? arena->liveCapacity * 2 : 256;
+    GpuRange** live = (GpuRange**)realloc(arena->live, capacity * sizeof(GpuRange*));
+    if (!live) {
+      fprintf(stderr, "Failed to grow GPU arena to %d live ranges\n", capacity);
+      return false;
+    }
+    arena->live = live;
+    arena->liveCapacity = capacity;
+  }
+
+  int i = 0;
+  while (i < arena->freeCount && arena->freeRanges[i].count < reserved) {
+    i++;
+  }
+  if (i == arena->freeCount) {
+    int capacity = arena->capacity;
+    while (capacity - arena->used < reserved) {
+      capacity *= 2;
+    }
+    relayoutArena(arena, capacity);
+    i = arena->freeCount - 1; // Everything free is now one range at the end
+  }
+
+  GpuFreeRange* hole = &arena->freeRanges[i];
+  range->offset = hole->offset;
+  hole->offset += reserved;
+  hole->count -= reserved;
+  if (hole->count == 0) {
+    arena->freeCount--;
+    for (int j = i; j < arena->freeCount; j++) {
+      arena->freeRanges[j] = arena->freeRanges[j + 1];
+    }
+  }
+
+  arena->live[arena->liveCount++] = range;
+  range->slot = arena->liveCount;
+  arena->used += reserved;
+  return true;
+}
+
+void gpuArenaFree(GpuArena* arena, GpuRange* range) {
+  if (range->slot == 0) {
+    return;
+  }
+
+  // Swap the last live range into the freed slot
+  GpuRange* last = arena->live[--arena->liveCount];
+  arena->live[range->slot - 1] = last;
+  last->slot = range->slot;
+
+  int reserved = roundCount(arena, range->count);
+  insertFreeRange(arena, range->offset, reserved);
+  arena->used -= reserved;
+  *range = (GpuRange){0};
+
+  if (arena->freeCount > ARENA_COMPACT_FREE_RANGES) {
+    gpuArenaCompact(arena);
+  }
+}
+
+void gpuArenaUpload(const GpuArena* arena, const GpuRange* range, const void* data) {
+  if (range->count == 0) {
+    return;
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, arena->buffer);
+  glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)range->offset * arena->elementSize, (GLsizeiptr)range->count * arena->elementSize, data);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Pack every live range together, leaving a single free range at the end of the buffer.
+void gpuArenaCompact(GpuArena* arena) {
+  relayoutArena(arena, arena->capacity);
+}
+
+GpuArenaStats gpuArenaGetStats(const GpuArena* arena) {
+  int freeTotal = 0;
+  int largest = 0;
+  for (int i = 0; i < arena->freeCount; i++) {
+    freeTotal += arena->freeRanges[i].count;
+    if (arena->freeRanges[i].count > largest) {
+      largest = arena->freeRanges[i].count;
+    }
+  }
+
+  GpuArenaStats stats;
+  stats.usedBytes = (size_t)arena->used * arena->elementSize;
+  stats.capacityBytes = (size_t)arena->capacity * arena->elementSize;
+  stats.freeRanges = arena->freeCount;
+  stats.fragmentation = freeTotal ? 1.0f - (float)largest / freeTotal : 0.0f;
+  stats.compactions = arena->compactions;
+  return stats;
+}
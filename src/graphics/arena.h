@@ -0,0 +1,64 @@
+/**
+ * @file graphics/arena.h
+ * @brief One large GPU buffer shared by many meshes, handed out in ranges.
+ * @author frankischilling
+ * @date 2024-12-15
+ */
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <GL/glew.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Range of elements owned by one mesh. The arena keeps a pointer to it and rewrites
+// offset when compaction moves the data, so the range must not move while allocated.
+typedef struct {
+  int offset; // First element in the arena buffer, a multiple of the arena granularity
+  int count;  // Elements requested, the arena reserves count rounded up to its granularity
+  int slot;   // Index + 1 in the arena list of live ranges, 0 when not allocated
+} GpuRange;
+
+typedef struct {
+  int offset;
+  int count;
+} GpuFreeRange;
+
+// Free space is a list of ranges sorted by offset, neighbouring free ranges are always merged.
+// When no free range fits, live ranges are packed to the front of a new buffer, which grows if needed.
+typedef struct {
+  GLuint buffer;
+  GLuint texture;       // Buffer texture over the whole buffer, 0 without a texture format
+  GLenum textureFormat; // Texel format of the buffer texture, one texel per element
+  int elementSize;      // in bytes
+  int granularity;      // Ranges start on and span multiples of this many elements
+  int capacity;         // in elements
+  int used;             // elements reserved by live ranges
+  GpuFreeRange* freeRanges;
+  int freeCount;
+  int freeCapacity;
+  GpuRange** live;
+  int liveCount;
+  int liveCapacity;
+  unsigned generation; // Changes whenever the buffer object is replaced
+  int compactions;
+} GpuArena;
+
+typedef struct {
+  size_t usedBytes;
+  size_t capacityBytes;
+  int freeRanges;
+  float fragmentation; // 1 - largest free range / free space, 0 when free space is one range
+  int compactions;
+} GpuArenaStats;
+
+bool gpuArenaInit(GpuArena* arena, int elementSize, int granularity, GLenum textureFormat, int capacity);
+int gpuArenaReservedCount(const GpuArena* arena, const GpuRange* range);
+void gpuArenaDestroy(GpuArena* arena);
+bool gpuArenaAlloc(GpuArena* arena, GpuRange* range, int count);
+void gpuArenaFree(GpuArena* arena, GpuRange* range);
+void gpuArenaUpload(const GpuArena* arena, const GpuRange* range, const void* data);
+void gpuArenaCompact(GpuArena* arena);
+GpuArenaStats gpuArenaGetStats(const GpuArena* arena);
+
+#endif // ARENA_H
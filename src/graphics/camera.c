@@ -28,6 +28,16 @@ void initCamera(Camera* camera) {
   updateCameraVectors(camera);
 }
 
+void getCameraViewMatrix(const Camera* camera, Mat4 view) {
+  Vec3 target;
+  vec3_add(&target, &camera->position, &camera->front);
+  mat4_lookAt(view, &camera->position, &target, &camera->up);
+}
+
+void getCameraProjectionMatrix(Mat4 projection) {
+  mat4_perspective(projection, CAMERA_FOV, CAMERA_ASPECT, CAMERA_NEAR, CAMERA_FAR);
+}
+
 void updateCameraVectors(Camera* camera) {
   // Calculate new front vector
   camera->front.x = cosf(toRadians(camera->yaw)) * cosf(toRadians(camera->pitch));
@@ -10,6 +10,12 @@
 #include "../math/math.h"
 #include <GLFW/glfw3.h>
 
+// One projection for everything drawn in the world and for frustum culling
+#define CAMERA_FOV 70.0f // Vertical field of view in degrees
+#define CAMERA_ASPECT (1920.0f / 1080.0f)
+#define CAMERA_NEAR 0.1f
+#define CAMERA_FAR 1000.0f
+
 typedef struct {
   Vec3 position;
   Vec3 front;
@@ -25,5 +31,7 @@ void initCamera(Camera* camera);
 void processInput(GLFWwindow* window, Camera* camera, float deltaTime);
 void mouseCallback(GLFWwindow* window, double xpos, double ypos);
 void updateCameraVectors(Camera* camera);
+void getCameraViewMatrix(const Camera* camera, Mat4 view);
+void getCameraProjectionMatrix(Mat4 projection);
 
 #endif
\ No newline at end of file
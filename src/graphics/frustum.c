@@ -8,6 +8,7 @@
 #include "../world/world.h" // For getBlock function
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 void frustum_update(Frustum* frustum, const Mat4 projection, const Mat4 view) {
   // Combine projection and view matrices
@@ -22,6 +23,8 @@ void frustum_update(Frustum* frustum, const Mat4 projection, const Mat4 view) {
     }
   }
 
+  memcpy(frustum->clip, clip, sizeof(Mat4));
+
   // Right plane
   frustum->planes[0][0] = clip[3] - clip[0];
   frustum->planes[0][1] = clip[7] - clip[4];
@@ -101,11 +104,7 @@ bool is_face_visible(Vec3i* posi, int face, const Camera* camera) {
 
 bool is_block_occluded(Vec3i* pos, float size, const Camera* camera) {
   // Get the block type of current block
-  Block* block = getBlock(pos);
-  if (!block) {
-    printf("BLOCK IS NULL AT %d, %d, %d this shouldnt happen\n", pos->x, pos->y, pos->z);
-  }
-  enum BlockID current = block->id;
+  enum BlockID current = getBlock(pos);
   if (current == BLOCK_AIR) {
     printf("AIR CHECKED FOR OCCLUSION AT p: %d, %d, %d this shouldnt happen\n", pos->x, pos->y, pos->z);
     return true;
@@ -119,12 +118,8 @@ bool is_block_occluded(Vec3i* pos, float size, const Camera* camera) {
     if (checkVector.y < 0) {
       checkVector.y = 0;
     }
-    Block* neighborBlock = getBlock(&checkVector);
-    if (!neighborBlock) {
-      // If block is next to world border, make it visible
-      return false;
-    }
-    enum BlockID neighborID = block->id;
+    // Blocks next to the world border see air, so they stay visible
+    enum BlockID neighborID = getBlock(&checkVector);
     if (neighborID == BLOCK_AIR) {
       // If any face is exposed to air, the block is visible
       return false;
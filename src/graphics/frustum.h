@@ -16,6 +16,7 @@
 // Frustum structure to hold the six planes
 typedef struct {
   Plane planes[6]; // Six planes (right, left, top, bottom, near, far), each with ABCD coefficients
+  Mat4 clip;       // Projection times view, column major, takes world positions to clip space
 } Frustum;
 
 // Function declarations
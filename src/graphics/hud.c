@@ -10,25 +10,37 @@
 #include "../utils/text.h"
 #include "../world/world.h"
 #include "../utils/raycast.h"
+#include "../math/noise.h"
 
 static DebugEntry entryBiome;
 static DebugEntry entryFPS;
 static DebugEntry entryCubeCount;
+static DebugEntry entryMesh;
+static DebugEntry entryChunks;
+static DebugEntry entryArena;
+static DebugEntry entryOverdraw;
+static DebugEntry entryCulling;
 static DebugEntry entryBuildInfo;
 static DebugEntry entryWorldCoords;
 static DebugEntry entryChunkCoords;
 static DebugEntry entryLookingAtBlockCoords;
 
-void HUDDraw(GLuint shaderProgram, DebugData* data) {
+void HUDDraw(const ShaderProgram* shaderProgram, DebugData* data) {
   UpdateEntries(data);
-  Ray cast = rayCast(data->camera);
-  snprintf(entryLookingAtBlockCoords.text, sizeof(entryLookingAtBlockCoords.text), "Block coordinates: X:%d Y:%d Z:%d", cast.blockCoords.x, cast.blockCoords.y, cast.blockCoords.z);
+  Ray cast = rayCast(data->camera, RAYCAST_REACH);
+  snprintf(entryLookingAtBlockCoords.text, sizeof(entryLookingAtBlockCoords.text), "Block: X:%d Y:%d Z:%d Face: %d,%d,%d Distance: %.1f", cast.blockCoords.x, cast.blockCoords.y,
+           cast.blockCoords.z, cast.normal.x, cast.normal.y, cast.normal.z, cast.distance);
 
   int i = 0;
   EntryDraw(shaderProgram, &entryBiome, &i);
   EntryDraw(shaderProgram, &entryChunkCoords, &i);
   EntryDraw(shaderProgram, &entryWorldCoords, &i);
   EntryDraw(shaderProgram, &entryCubeCount, &i);
+  EntryDraw(shaderProgram, &entryMesh, &i);
+  EntryDraw(shaderProgram, &entryChunks, &i);
+  EntryDraw(shaderProgram, &entryArena, &i);
+  EntryDraw(shaderProgram, &entryOverdraw, &i);
+  EntryDraw(shaderProgram, &entryCulling, &i);
   EntryDraw(shaderProgram, &entryFPS, &i);
   EntryDraw(shaderProgram, &entryBuildInfo, &i);
   if (cast.hit) {
@@ -37,7 +49,7 @@ void HUDDraw(GLuint shaderProgram, DebugData* data) {
 
   DrawCrosshair(shaderProgram);
 }
-static void DrawCrosshair(GLuint shaderProgram) {
+static void DrawCrosshair(const ShaderProgram* shaderProgram) {
   float screenWidth = 1920.0f;
   float screenHeight = 1080.0f;
   float centerX = screenWidth / 2.0f;
@@ -47,7 +59,7 @@ static void DrawCrosshair(GLuint shaderProgram) {
 
   // MISSING DRAWING THE ACTUAL CROSSHAIR
 }
-static void EntryDraw(GLuint shaderProgram, DebugEntry* entry, int* entryIndex) {
+static void EntryDraw(const ShaderProgram* shaderProgram, DebugEntry* entry, int* entryIndex) {
   renderText(shaderProgram, entry->text, 10.0f, 100.0f + *entryIndex);
   *entryIndex += 20;
 }
@@ -55,6 +67,14 @@ static void UpdateEntries(DebugData* data) {
   snprintf(entryFPS.text, sizeof(entryFPS.text), "FPS: %.1f", data->fps);
   snprintf(entryBiome.text, sizeof(entryBiome.text), "Current biome: %s", getCurrentBiomeText(data->camera->position.x, data->camera->position.z));
   snprintf(entryCubeCount.text, sizeof(entryCubeCount.text), "Visible Cubes: %d", data->visibleBlocks);
+  snprintf(entryChunks.text, sizeof(entryChunks.text), "Chunks: %d loaded %d queued %.1f MB", data->loadedChunks, data->queuedChunks,
+           data->chunkMemory / (1024.0 * 1024.0));
+  snprintf(entryArena.text, sizeof(entryArena.text), "GPU: %.1f/%.1f MB %d holes %.0f%% fragmented %d compactions", data->meshArena.usedBytes / (1024.0 * 1024.0),
+           data->meshArena.capacityBytes / (1024.0 * 1024.0), data->meshArena.freeRanges, data->meshArena.fragmentation * 100.0f, data->meshArena.compactions);
+  snprintf(entryOverdraw.text, sizeof(entryOverdraw.text), "Overdraw: %.2f fragments/pixel, %s", data->overdraw, data->chunkSorting ? "front to back" : "unsorted");
+  snprintf(entryCulling.text, sizeof(entryCulling.text), "Culled chunks: %d frustum %d caves %d queries %d raster", data->frustumCulledChunks,
+           data->caveCulledChunks, data->occlusionCulledChunks, data->softwareCulledChunks);
+  snprintf(entryMesh.text, sizeof(entryMesh.text), "Mesh: %s/%s Triangles: %d Build: %.3f ms/build", data->meshMode, data->renderPath, data->triangles, data->meshBuildTime);
 
   snprintf(entryWorldCoords.text, sizeof(entryWorldCoords.text), "World coordinates: X:%.1f Y:%.1f Z:%.1f", data->camera->position.x, data->camera->position.y,
            data->camera->position.z);
@@ -68,5 +88,7 @@ void HUDInit(char* buildName, char* buildVersion) {
   entryBiome.text[0] = '\0';
   entryFPS.text[0] = '\0';
   entryCubeCount.text[0] = '\0';
-  snprintf(entryBuildInfo.text, sizeof(entryBuildInfo.text), "%s %s", buildName, buildVersion);
+  entryMesh.text[0] = '\0';
+  entryChunks.text[0] = '\0';
+  snprintf(entryBuildInfo.text, sizeof(entryBuildInfo.text), "%s %s Noise: %s", buildName, buildVersion, getPerlinBatchBackendText());
 }
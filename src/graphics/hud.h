@@ -8,7 +8,10 @@
 #define HUD_H
 
 #include <GL/glew.h>
+#include <stddef.h>
+#include "arena.h"
 #include "camera.h"
+#include "shader.h"
 typedef struct {
   char text[64];
 } DebugEntry;
@@ -16,11 +19,25 @@ typedef struct {
   Camera* camera;
   float fps;
   int visibleBlocks;
+  int triangles;
+  const char* meshMode;
+  const char* renderPath;
+  float meshBuildTime;
+  int loadedChunks;
+  int queuedChunks;
+  size_t chunkMemory;
+  GpuArenaStats meshArena;
+  float overdraw;
+  bool chunkSorting;
+  int frustumCulledChunks;
+  int caveCulledChunks;
+  int occlusionCulledChunks;
+  int softwareCulledChunks;
 } DebugData;
-void HUDDraw(GLuint shaderProgram, DebugData* data);
+void HUDDraw(const ShaderProgram* shaderProgram, DebugData* data);
 void HUDInit(char* buildName, char* buildVersion);
-static void EntryDraw(GLuint shaderProgram, DebugEntry* entry, int* i);
+static void EntryDraw(const ShaderProgram* shaderProgram, DebugEntry* entry, int* i);
 static void UpdateEntries(DebugData* data);
-static void DrawCrosshair(GLuint shaderProgram);
+static void DrawCrosshair(const ShaderProgram* shaderProgram);
 
 #endif // HUD_H
\ No newline at end of file
@@ -0,0 +1,273 @@
+/**
+ * @file graphics/occluder.c
+ * @brief Low resolution depth buffer rasterized on the CPU, for occlusion culling without GPU queries.
+ * @author frankischilling
+ * @date 2024-12-16
+ */
+#include "occluder.h"
+#include <math.h>
+
+typedef struct {
+  float x, y, z, w;
+} ClipVertex;
+
+// Corners of a box are numbered x | y << 1 | z << 2, every face is counter clockwise seen from outside
+static const int boxFaces[6][4] = {{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+
+static void getBoxCorners(const Mat4 clip, const Vec3* center, const Vec3* sizes, ClipVertex corners[8]) {
+  for (int c = 0; c < 8; c++) {
+    float x = center->x + (c & 1 ? 0.5f : -0.5f) * sizes->x;
+    float y = center->y + (c & 2 ? 0.5f : -0.5f) * sizes->y;
+    float z = center->z + (c & 4 ? 0.5f : -0.5f) * sizes->z;
+    corners[c].x = clip[0] * x + clip[4] * y + clip[8] * z + clip[12];
+    corners[c].y = clip[1] * x + clip[5] * y + clip[9] * z + clip[13];
+    corners[c].z = clip[2] * x + clip[6] * y + clip[10] * z + clip[14];
+    corners[c].w = clip[3] * x + clip[7] * y + clip[11] * z + clip[15];
+  }
+}
+
+// Clip space to buffer pixels and window depth
+static Vec3 toWindow(const ClipVertex* vertex) {
+  return (Vec3){(vertex->x / vertex->w * 0.5f + 0.5f) * OCCLUDER_WIDTH, (vertex->y / vertex->w * 0.5f + 0.5f) * OCCLUDER_HEIGHT, vertex->z / vertex->w * 0.5f + 0.5f};
+}
+
+// Edge of an outline as a * x + b * y + c >= 0, the left side is inside
+typedef struct {
+  float a, b, c;
+} OutlineEdge;
+
+// Window depth of a face plane as z = dx * x + dy * y + c
+typedef struct {
+  float dx, dy, c;
+} DepthPlane;
+
+// Faces on the other side of each edge of boxFaces, edge e runs from corner e to corner e + 1
+static const int boxFaceNeighbors[6][4] = {{2, 5, 3, 4}, {4, 3, 5, 2}, {4, 1, 5, 0}, {0, 5, 1, 4}, {0, 3, 1, 2}, {2, 1, 3, 0}};
+
+// The edge is moved inwards by the farthest a pixel corner gets from the pixel centre across it,
+// so a pixel centre passes only when the whole pixel is inside.
+static OutlineEdge getOutlineEdge(const Vec3* from, const Vec3* to) {
+  float a = from->y - to->y;
+  float b = to->x - from->x;
+  return (OutlineEdge){a, b, -(a * from->x + b * from->y) - 0.5f * (fabsf(a) + fabsf(b))};
+}
+
+// The plane is moved back by the most its depth changes from the pixel centre to a pixel corner,
+// so the depth at a pixel centre is the farthest the plane gets anywhere in the pixel.
+static DepthPlane getDepthPlane(const Vec3* a, const Vec3* b, const Vec3* c, float area) {
+  float dx = ((b->z - a->z) * (c->y - a->y) - (c->z - a->z) * (b->y - a->y)) / area;
+  float dy = ((c->z - a->z) * (b->x - a->x) - (b->z - a->z) * (c->x - a->x)) / area;
+  return (DepthPlane){dx, dy, a->z - dx * a->x - dy * a->y + 0.5f * (fabsf(dx) + fabsf(dy))};
+}
+
+static float getTriangleArea(const Vec3* a, const Vec3* b, const Vec3* c) {
+  return (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+}
+
+// Write depth to the pixels fully inside every edge of a convex outline. Seen through a pixel the front of a
+// convex solid lies on the farthest of its front facing planes, capped by the farthest corner of the solid.
+static void rasterizeOutline(OccluderBuffer* buffer, const Vec3* points, int pointCount, const OutlineEdge* edges, int edgeCount, const DepthPlane* planes, int planeCount) {
+  float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY, farthest = 0.0f;
+  for (int i = 0; i < pointCount; i++) {
+    minX = fminf(minX, points[i].x);
+    maxX = fmaxf(maxX, points[i].x);
+    minY = fminf(minY, points[i].y);
+    maxY = fmaxf(maxY, points[i].y);
+    farthest = fmaxf(farthest, points[i].z);
+  }
+  // Only pixels that lie within the bounds as a whole can be fully covered
+  int x0 = (int)fmaxf(ceilf(minX), 0.0f);
+  int x1 = (int)fminf(floorf(maxX), OCCLUDER_WIDTH) - 1;
+  int y0 = (int)fmaxf(ceilf(minY), 0.0f);
+  int y1 = (int)fminf(floorf(maxY), OCCLUDER_HEIGHT) - 1;
+
+  for (int y = y0; y <= y1; y++) {
+    float py = y + 0.5f;
+    for (int x = x0; x <= x1; x++) {
+      float px = x + 0.5f;
+      bool inside = true;
+      for (int e = 0; e < edgeCount && inside; e++) {
+        inside = edges[e].a * px + edges[e].b * py + edges[e].c >= 0.0f;
+      }
+      if (!inside) {
+        continue;
+      }
+      float depth = 0.0f;
+      for (int p = 0; p < planeCount; p++) {
+        depth = fmaxf(depth, planes[p].dx * px + planes[p].dy * py + planes[p].c);
+      }
+      depth = fminf(depth, farthest);
+      if (depth < buffer->depth[y][x]) {
+        buffer->depth[y][x] = depth;
+      }
+    }
+  }
+}
+
+// Cut a face at the near plane, z >= -w in clip space, and rasterize what is left as an outline of its own.
+// Cut faces of a box no longer share a convex outline, so the edges between them are not sealed.
+static void rasterizeFace(OccluderBuffer* buffer, const ClipVertex corners[8], const int face[4]) {
+  ClipVertex polygon[8];
+  int count = 0;
+  for (int i = 0; i < 4; i++) {
+    const ClipVertex* from = &corners[face[i]];
+    const ClipVertex* to = &corners[face[(i + 1) % 4]];
+    float fromDistance = from->z + from->w;
+    float toDistance = to->z + to->w;
+    if (fromDistance >= 0.0f) {
+      polygon[count++] = *from;
+    }
+    if ((fromDistance >= 0.0f) != (toDistance >= 0.0f)) {
+      float t = fromDistance / (fromDistance - toDistance);
+      polygon[count++] = (ClipVertex){from->x + (to->x - from->x) * t, from->y + (to->y - from->y) * t, from->z + (to->z - from->z) * t, from->w + (to->w - from->w) * t};
+    }
+  }
+  if (count < 3) {
+    return;
+  }
+
+  Vec3 window[8];
+  for (int i = 0; i < count; i++) {
+    window[i] = toWindow(&polygon[i]);
+  }
+  // The largest triangle of the fan gives the steadiest plane, back facing faces are skipped
+  int widest = 1;
+  float widestArea = 0.0f;
+  for (int i = 1; i + 1 < count; i++) {
+    float area = getTriangleArea(&window[0], &window[i], &window[i + 1]);
+    if (area > widestArea) {
+      widest = i;
+      widestArea = area;
+    }
+  }
+  if (widestArea <= 0.0f) {
+    return;
+  }
+  OutlineEdge edges[8];
+  for (int i = 0; i < count; i++) {
+    edges[i] = getOutlineEdge(&window[i], &window[(i + 1) % count]);
+  }
+  DepthPlane plane = getDepthPlane(&window[0], &window[widest], &window[widest + 1], widestArea);
+  rasterizeOutline(buffer, window, count, edges, count, &plane, 1);
+}
+
+// Clear the buffer to the far plane and take over the clip matrix of the frustum.
+void occluderBufferBegin(OccluderBuffer* buffer, const Frustum* frustum) {
+  for (int i = 0; i < 16; i++) {
+    buffer->clip[i] = frustum->clip[i];
+  }
+  for (int y = 0; y < OCCLUDER_HEIGHT; y++) {
+    for (int x = 0; x < OCCLUDER_WIDTH; x++) {
+      buffer->depth[y][x] = 1.0f;
+    }
+  }
+}
+
+// Draw a box that is solid all the way through, the faces turned towards the camera hide what is behind it.
+// Depth is only written where the box covers a pixel completely and never nearer than the box gets inside
+// that pixel, so the buffer can only err towards visible. The outline of the box is made of the edges between
+// its front and back facing faces, which also keeps the edges between its front faces free of gaps.
+void occluderBufferDrawBox(OccluderBuffer* buffer, const Vec3* center, const Vec3* sizes) {
+  ClipVertex corners[8];
+  getBoxCorners(buffer->clip, center, sizes, corners);
+  for (int c = 0; c < 8; c++) {
+    if (corners[c].z + corners[c].w < 0.0f) {
+      for (int face = 0; face < 6; face++) {
+        rasterizeFace(buffer, corners, boxFaces[face]);
+      }
+      return;
+    }
+  }
+
+  Vec3 window[8];
+  for (int c = 0; c < 8; c++) {
+    window[c] = toWindow(&corners[c]);
+  }
+  bool front[6];
+  float areas[6];
+  for (int face = 0; face < 6; face++) {
+    areas[face] = getTriangleArea(&window[boxFaces[face][0]], &window[boxFaces[face][1]], &window[boxFaces[face][2]]);
+    front[face] = areas[face] > 0.0f;
+  }
+  OutlineEdge edges[12];
+  DepthPlane planes[6];
+  int edgeCount = 0, planeCount = 0;
+  for (int face = 0; face < 6; face++) {
+    if (!front[face]) {
+      continue;
+    }
+    const int* quad = boxFaces[face];
+    planes[planeCount++] = getDepthPlane(&window[quad[0]], &window[quad[1]], &window[quad[2]], areas[face]);
+    for (int e = 0; e < 4; e++) {
+      if (!front[boxFaceNeighbors[face][e]]) {
+        edges[edgeCount++] = getOutlineEdge(&window[quad[e]], &window[quad[(e + 1) % 4]]);
+      }
+    }
+  }
+  if (planeCount > 0) {
+    rasterizeOutline(buffer, window, 8, edges, edgeCount, planes, planeCount);
+  }
+}
+
+// Build the coarse level once every occluder is drawn.
+void occluderBufferFinish(OccluderBuffer* buffer) {
+  for (int ty = 0; ty < OCCLUDER_HEIGHT / OCCLUDER_TILE; ty++) {
+    for (int tx = 0; tx < OCCLUDER_WIDTH / OCCLUDER_TILE; tx++) {
+      float farthest = 0.0f;
+      for (int y = ty * OCCLUDER_TILE; y < (ty + 1) * OCCLUDER_TILE; y++) {
+        for (int x = tx * OCCLUDER_TILE; x < (tx + 1) * OCCLUDER_TILE; x++) {
+          farthest = fmaxf(farthest, buffer->depth[y][x]);
+        }
+      }
+      buffer->tileMax[ty][tx] = farthest;
+    }
+  }
+}
+
+// Check whether any part of a box can be in front of the occluders. The box is reduced to its screen
+// rectangle at the depth of its nearest corner, which only ever errs towards visible.
+bool occluderBufferBoxVisible(const OccluderBuffer* buffer, const Vec3* center, const Vec3* sizes) {
+  ClipVertex corners[8];
+  getBoxCorners(buffer->clip, center, sizes, corners);
+
+  float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY, nearest = INFINITY;
+  for (int c = 0; c < 8; c++) {
+    if (corners[c].z + corners[c].w < 0.0f) {
+      return true; // Reaches past the near plane
+    }
+    Vec3 window = toWindow(&corners[c]);
+    minX = fminf(minX, window.x);
+    maxX = fmaxf(maxX, window.x);
+    minY = fminf(minY, window.y);
+    maxY = fmaxf(maxY, window.y);
+    nearest = fminf(nearest, window.z);
+  }
+  if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUDER_WIDTH || minY >= OCCLUDER_HEIGHT) {
+    return true; // Off screen, which the frustum test decides
+  }
+  int x0 = (int)fmaxf(floorf(minX), 0.0f);
+  int x1 = (int)fminf(floorf(maxX), OCCLUDER_WIDTH - 1);
+  int y0 = (int)fmaxf(floorf(minY), 0.0f);
+  int y1 = (int)fminf(floorf(maxY), OCCLUDER_HEIGHT - 1);
+
+  for (int ty = y0 / OCCLUDER_TILE; ty <= y1 / OCCLUDER_TILE; ty++) {
+    for (int tx = x0 / OCCLUDER_TILE; tx <= x1 / OCCLUDER_TILE; tx++) {
+      if (buffer->tileMax[ty][tx] < nearest) {
+        continue; // Every pixel of the tile is in front of the box
+      }
+      int tileX0 = tx * OCCLUDER_TILE, tileY0 = ty * OCCLUDER_TILE;
+      int tileX1 = tileX0 + OCCLUDER_TILE - 1, tileY1 = tileY0 + OCCLUDER_TILE - 1;
+      if (tileX0 >= x0 && tileX1 <= x1 && tileY0 >= y0 && tileY1 <= y1) {
+        return true; // The farthest pixel of the tile lies inside the rectangle
+      }
+      for (int y = y0 > tileY0 ? y0 : tileY0; y <= (y1 < tileY1 ? y1 : tileY1); y++) {
+        for (int x = x0 > tileX0 ? x0 : tileX0; x <= (x1 < tileX1 ? x1 : tileX1); x++) {
+          if (buffer->depth[y][x] >= nearest) {
+            return true;
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file graphics/occluder.h
+ * @brief Low resolution depth buffer rasterized on the CPU, for occlusion culling without GPU queries.
+ * @author frankischilling
+ * @date 2024-12-16
+ */
+#ifndef OCCLUDER_H
+#define OCCLUDER_H
+
+#include <stdbool.h>
+#include "../math/math.h"
+#include "frustum.h"
+
+#define OCCLUDER_WIDTH 256
+#define OCCLUDER_HEIGHT 128
+#define OCCLUDER_TILE 8 // Pixels along each side of a tile of the coarse level
+
+// Depth is stored as window depth, 0 at the near plane and 1 at the far plane, rows go bottom to top.
+// The coarse level keeps the farthest depth of each tile, so most tests never look at single pixels.
+typedef struct {
+  Mat4 clip; // Clip matrix of the frustum the buffer was started with
+  float depth[OCCLUDER_HEIGHT][OCCLUDER_WIDTH];
+  float tileMax[OCCLUDER_HEIGHT / OCCLUDER_TILE][OCCLUDER_WIDTH / OCCLUDER_TILE];
+} OccluderBuffer;
+
+void occluderBufferBegin(OccluderBuffer* buffer, const Frustum* frustum);
+void occluderBufferDrawBox(OccluderBuffer* buffer, const Vec3* center, const Vec3* sizes);
+void occluderBufferFinish(OccluderBuffer* buffer);
+bool occluderBufferBoxVisible(const OccluderBuffer* buffer, const Vec3* center, const Vec3* sizes);
+
+#endif // OCCLUDER_H
@@ -116,3 +116,70 @@ GLuint loadShaders(const char* vertexPath, const char* fragmentPath) {
 
   return shaderProgram;
 }
+
+static const char* const uniformNames[UNIFORM_COUNT] = {
+    [UNIFORM_MODEL] = "model",
+    [UNIFORM_NORMAL_MATRIX] = "normalMatrix",
+    [UNIFORM_OBJECT_COLOR] = "objectColor",
+    [UNIFORM_TEXT_COLOR] = "textColor",
+    [UNIFORM_BLOCK_TEXTURES] = "blockTextures",
+    [UNIFORM_FACES] = "faces",
+    [UNIFORM_CHUNK_PAGES] = "chunkPages",
+    [UNIFORM_CORNER_POSITIONS] = "cornerPositions",
+    [UNIFORM_CORNER_TEX_COORDS] = "cornerTexCoords",
+};
+
+static GLuint frameBuffer;
+
+// Load a program and resolve its uniform locations and the Frame block binding right after linking,
+// so drawing never looks uniforms up by name.
+bool loadShaderProgram(ShaderProgram* program, const char* vertexPath, const char* fragmentPath) {
+  program->id = loadShaders(vertexPath, fragmentPath);
+  if (!program->id) {
+    return false;
+  }
+
+  for (int uniform = 0; uniform < UNIFORM_COUNT; uniform++) {
+    program->uniforms[uniform] = glGetUniformLocation(program->id, uniformNames[uniform]);
+  }
+
+  GLuint frameBlock = glGetUniformBlockIndex(program->id, "Frame");
+  if (frameBlock != GL_INVALID_INDEX) {
+    glUniformBlockBinding(program->id, frameBlock, FRAME_UNIFORM_BINDING);
+  }
+  return true;
+}
+
+void destroyShaderProgram(ShaderProgram* program) {
+  glDeleteProgram(program->id);
+  *program = (ShaderProgram){0};
+}
+
+// Set the model matrix of a program in use, with the normal matrix derived from it on the CPU once per draw.
+void setModelMatrix(const ShaderProgram* program, const Mat4 model) {
+  Mat3 normalMatrix;
+  mat4_normalMatrix(normalMatrix, model);
+  glUniformMatrix4fv(program->uniforms[UNIFORM_MODEL], 1, GL_FALSE, model);
+  glUniformMatrix3fv(program->uniforms[UNIFORM_NORMAL_MATRIX], 1, GL_FALSE, normalMatrix);
+}
+
+// Create the uniform buffer behind the Frame block and bind it for every program.
+void initFrameUniforms() {
+  glGenBuffers(1, &frameBuffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameBuffer);
+}
+
+// Upload the camera and light data once per frame, before anything is drawn.
+void updateFrameUniforms(const FrameUniforms* frame) {
+  glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), frame);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void cleanupFrameUniforms() {
+  glDeleteBuffers(1, &frameBuffer);
+  frameBuffer = 0;
+}
@@ -8,8 +8,46 @@
 #define SHADER_H
 
 #include <GL/glew.h>
+#include <stdbool.h>
+#include "../math/math.h"
+
+#define FRAME_UNIFORM_BINDING 0 // Uniform buffer binding point of the Frame block
+
+// Uniforms looked up once when a program is loaded, programs without one keep its location at -1
+typedef enum {
+  UNIFORM_MODEL,
+  UNIFORM_NORMAL_MATRIX,
+  UNIFORM_OBJECT_COLOR,
+  UNIFORM_TEXT_COLOR,
+  UNIFORM_BLOCK_TEXTURES,
+  UNIFORM_FACES,
+  UNIFORM_CHUNK_PAGES,
+  UNIFORM_CORNER_POSITIONS,
+  UNIFORM_CORNER_TEX_COORDS,
+  UNIFORM_COUNT,
+} UniformID;
+
+typedef struct {
+  GLuint id;
+  GLint uniforms[UNIFORM_COUNT];
+} ShaderProgram;
+
+// Per frame data of the Frame uniform block, std140 layout, shared by every program
+typedef struct {
+  Mat4 view;
+  Mat4 projection;
+  GLfloat viewPos[4];
+  GLfloat lightPos[4];
+  GLfloat lightColor[4];
+} FrameUniforms;
 
 GLuint loadShaders(const char* vertexPath, const char* fragmentPath);
-void renderText(GLuint shaderProgram, const char* text, float x, float y);
+bool loadShaderProgram(ShaderProgram* program, const char* vertexPath, const char* fragmentPath);
+void destroyShaderProgram(ShaderProgram* program);
+void setModelMatrix(const ShaderProgram* program, const Mat4 model);
+void initFrameUniforms();
+void updateFrameUniforms(const FrameUniforms* frame);
+void cleanupFrameUniforms();
+void renderText(const ShaderProgram* shaderProgram, const char* text, float x, float y);
 
 #endif
\ No newline at end of file
@@ -3,36 +3,45 @@
 #include "../../libs/stb_image.h"
 #include <stdio.h>
 
-// Function to load a texture from a file
-GLuint loadTexture(const char* filePath) {
+// Load same sized images into the layers of one GL_TEXTURE_2D_ARRAY, layer i holds filePaths[i].
+// Layers that fail to load or have the wrong size are left black.
+GLuint loadTextureArray(const char* const filePaths[], int layerCount) {
   GLuint textureID;
   glGenTextures(1, &textureID);
-  glBindTexture(GL_TEXTURE_2D, textureID);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
 
-  int width, height, nrChannels;
-  unsigned char* data = stbi_load(filePath, &width, &height, &nrChannels, 0);
-  if (data) {
-    GLenum format;
-    if (nrChannels == 1)
-      format = GL_RED;
-    else if (nrChannels == 3)
-      format = GL_RGB;
-    else if (nrChannels == 4)
-      format = GL_RGBA;
+  int layerWidth = 0, layerHeight = 0;
+  for (int layer = 0; layer < layerCount; layer++) {
+    int width, height, nrChannels;
+    // Always expand to RGBA so every layer shares one format
+    unsigned char* data = stbi_load(filePaths[layer], &width, &height, &nrChannels, 4);
+    if (!data) {
+      fprintf(stderr, "Failed to load texture: %s\n", filePaths[layer]);
+      continue;
+    }
 
-    // Use nearest neighbor filtering for pixel art/low-res textures
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    // Disable mipmapping for pixel textures
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-  } else {
-    fprintf(stderr, "Failed to load texture: %s\n", filePath);
+    // The first image decides the size of every layer
+    if (layerWidth == 0) {
+      layerWidth = width;
+      layerHeight = height;
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, layerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    if (width != layerWidth || height != layerHeight) {
+      fprintf(stderr, "Texture %s is %dx%d, texture array layers are %dx%d\n", filePaths[layer], width, height, layerWidth, layerHeight);
+    } else {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    }
+    stbi_image_free(data);
   }
-  stbi_image_free(data);
 
+  // Same sampling as the single textures: nearest filtering, repeating so greedy meshed quads tile
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
   return textureID;
 }
@@ -3,6 +3,6 @@
 
 #include <GL/glew.h>
 
-GLuint loadTexture(const char* filePath);
+GLuint loadTextureArray(const char* const filePaths[], int layerCount);
 
 #endif // TEXTURE_H
@@ -11,6 +11,7 @@
 #include "utils/text.h"
 #include "world/world.h"
 #include "graphics/hud.h"
+#include "utils/raycast.h"
 
 #define BUILD_VERSION "v0.0.3-alpha"
 #define BUILD_NAME "kernelcraft"
@@ -33,6 +34,61 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
       glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
   }
+  // Cycle through the chunk meshers to compare them on the same world
+  if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+    setMeshMode((getMeshMode() + 1) % MESH_MODE_COUNT);
+  }
+  // Switch between vertex buffers and face records pulled in the shader
+  if (key == GLFW_KEY_V && action == GLFW_PRESS) {
+    setRenderPath((getRenderPath() + 1) % RENDER_PATH_COUNT);
+  }
+  // Toggle front to back chunk ordering, the HUD overdraw shows what it saves
+  if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+    setChunkSorting(!getChunkSorting());
+  }
+  // Toggle the section visibility walk that hides chunks behind terrain
+  if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+    setCaveCulling(!getCaveCulling());
+  }
+  // Toggle hardware occlusion queries on chunk bounding boxes
+  if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
+    setOcclusionCulling(!getOcclusionCulling());
+  }
+  // Toggle culling against the ground rasterized on the CPU
+  if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+    setSoftwareCulling(!getSoftwareCulling());
+  }
+  // Cycle the terrain lattice spacing through 1, 2, 4, 8, 16 and report how far it is from full resolution
+  if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+    int spacing = getTerrainSampleSpacing() * 2;
+    spacing = spacing > CHUNK_SIZE ? 1 : spacing;
+    Vec3i cameraBlock = {(int)floorf(camera.position.x), 0, (int)floorf(camera.position.z)};
+    Vec2i center = blockToChunk(&cameraBlock);
+    TerrainSampleError error = measureTerrainSampleError(&center, CHUNK_LOAD_RADIUS, spacing);
+    printf("Terrain spacing %d: mean error %.3f, max error %.3f, %.1f%% of columns changed\n", spacing, error.meanError, error.maxError, error.changedColumns * 100.0f);
+    setTerrainSampleSpacing(spacing);
+  }
+}
+
+// Left click breaks the block under the crosshair, right click places stone against the face it points at
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+  if (cursorEnabled || action != GLFW_PRESS) {
+    return;
+  }
+  Ray ray = rayCast(&camera, RAYCAST_REACH);
+  if (!ray.hit) {
+    return;
+  }
+  if (button == GLFW_MOUSE_BUTTON_LEFT) {
+    setBlock(&ray.blockCoords, BLOCK_AIR);
+  } else if (button == GLFW_MOUSE_BUTTON_RIGHT) {
+    Vec3i target;
+    vec3i_add(&target, &ray.blockCoords, &ray.normal);
+    Vec3i cameraBlock = {(int)floorf(camera.position.x), (int)floorf(camera.position.y), (int)floorf(camera.position.z)};
+    if (target.x != cameraBlock.x || target.y != cameraBlock.y || target.z != cameraBlock.z) {
+      setBlock(&target, BLOCK_STONE);
+    }
+  }
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -63,14 +119,14 @@ int main(int argc, char** argv) {
 
   glEnable(GL_DEPTH_TEST);
 
-  GLuint shaderProgram = loadShaders("assets/shaders/vertex_shader.glsl", "assets/shaders/fragment_shader.glsl");
-  if (!shaderProgram) {
+  initFrameUniforms();
+  ShaderProgram shaderProgram;
+  if (!loadShaderProgram(&shaderProgram, "assets/shaders/vertex_shader.glsl", "assets/shaders/fragment_shader.glsl")) {
     fprintf(stderr, "Failed to load shaders\n");
     return -1;
   }
 
   initWorld();
-  initCube();
   initChunks();
   HUDInit(BUILD_NAME, BUILD_VERSION);
 
@@ -79,6 +135,7 @@ int main(int argc, char** argv) {
   glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   glfwSetWindowUserPointer(window, &camera);
   glfwSetKeyCallback(window, key_callback);
+  glfwSetMouseButtonCallback(window, mouse_button_callback);
 
   initCamera(&camera);
 
@@ -100,32 +157,42 @@ int main(int argc, char** argv) {
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glUseProgram(shaderProgram);
-
-    Mat4 model, view, projection;
-    mat4_identity(model);
-    Vec3 target;
-    vec3_add(&target, &camera.position, &camera.front);
-    mat4_lookAt(view, &camera.position, &target, &camera.up);
-    mat4_perspective(projection, 45.0f, 1920.0f / 1080.0f, 0.1f, 100.0f);
-
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
-
-    renderChunkGrid(shaderProgram, &camera);
-    RenderResult result = renderWorld(shaderProgram, &camera);
-
-    DebugData data = (DebugData){&camera, fps, result.visisbleCubes};
-    HUDDraw(shaderProgram, &data);
+    // Every program reads the camera from the same uniform buffer
+    uploadFrameUniforms(&camera);
+
+    StreamStats stream = updateWorld(&camera);
+    renderChunkGrid(&shaderProgram, &camera);
+    RenderResult result = renderWorld(&camera);
+
+    DebugData data = (DebugData){&camera,
+                                 fps,
+                                 result.visisbleCubes,
+                                 result.triangles,
+                                 getMeshModeText(getMeshMode()),
+                                 getRenderPathText(getRenderPath()),
+                                 result.meshBuildTime,
+                                 stream.loadedChunks,
+                                 stream.queuedChunks,
+                                 stream.chunkMemory,
+                                 result.meshArena,
+                                 result.overdraw,
+                                 getChunkSorting(),
+                                 result.frustumCulledChunks,
+                                 result.caveCulledChunks,
+                                 result.occlusionCulledChunks,
+                                 result.softwareCulledChunks};
+    HUDDraw(&shaderProgram, &data);
 
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
-  glfwDestroyWindow(window);
-  glfwTerminate();
+  // Release GL objects while the context is still alive
   cleanupChunks();
   cleanupWorld();
+  destroyShaderProgram(&shaderProgram);
+  cleanupFrameUniforms();
+  glfwDestroyWindow(window);
+  glfwTerminate();
   return 0;
 }
\ No newline at end of file
@@ -186,6 +186,31 @@ void mat4_lookAt(Mat4 result, const Vec3* eye, const Vec3* center, const Vec3* u
   result[15] = 1.0f;
 }
 
+// Inverse transpose of the upper 3x3 of model, which keeps normals perpendicular under non uniform scaling.
+// Its columns are the cross products of pairs of model columns divided by the determinant.
+void mat4_normalMatrix(Mat3 result, const Mat4 model) {
+  Vec3 c0 = {model[0], model[1], model[2]};
+  Vec3 c1 = {model[4], model[5], model[6]};
+  Vec3 c2 = {model[8], model[9], model[10]};
+
+  Vec3 n0, n1, n2;
+  vec3_cross(&n0, &c1, &c2);
+  vec3_cross(&n1, &c2, &c0);
+  vec3_cross(&n2, &c0, &c1);
+  float determinant = vec3_dot(&c0, &n0);
+  float scale = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+
+  result[0] = n0.x * scale;
+  result[1] = n0.y * scale;
+  result[2] = n0.z * scale;
+  result[3] = n1.x * scale;
+  result[4] = n1.y * scale;
+  result[5] = n1.z * scale;
+  result[6] = n2.x * scale;
+  result[7] = n2.y * scale;
+  result[8] = n2.z * scale;
+}
+
 static const int permutation[256] = {
     151, 160, 137, 91,  90,  15,  131, 13,  201, 95,  96,  53,  194, 233, 7,   225, 140, 36,  103, 30,  69,  142, 8,   99,  37,  240, 21,  10,  23,  190, 6,   148,
     247, 120, 234, 75,  0,   26,  197, 62,  94,  252, 219, 203, 117, 35,  11,  32,  57,  177, 33,  88,  237, 149, 56,  87,  174, 20,  125, 136, 171, 168, 68,  175,
@@ -44,6 +44,7 @@ enum Face {
 extern Vec3 vec3FaceMap[6];
 extern Vec3i vec3iFaceMap[6];
 
+typedef float Mat3[9];
 typedef float Mat4[16];
 typedef float Plane[4];
 // Helper functions
@@ -80,6 +81,7 @@ float vec2i_distance(const Vec2i* a, const Vec2i* b);
 void mat4_identity(Mat4 result);
 void mat4_perspective(Mat4 result, float fovy, float aspect, float near, float far);
 void mat4_lookAt(Mat4 result, const Vec3* eye, const Vec3* center, const Vec3* up);
+void mat4_normalMatrix(Mat3 result, const Mat4 model);
 
 // Noise generation
 float noise2d(float x, float z);
@@ -0,0 +1,288 @@
+/**
+ * @file math/noise.c
+ * @brief Batched Perlin noise, vectorized with SSE2 and AVX2 where the CPU has them.
+ * @author frankischilling
+ * @date 2024-12-12
+ */
+#include "noise.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "math.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NOISE_X86 1
+#include <immintrin.h>
+#endif
+
+// The permutation table repeated twice so hashed indices up to 511 need no wrapping.
+// Perlin only ever looks up values below 512: perm(X) + Y + 1 and perm(A) + Z + 1 are at most 511.
+static int32_t permTable[512];
+static pthread_once_t permTableOnce = PTHREAD_ONCE_INIT;
+
+static void initPermTable() {
+  for (int i = 0; i < 512; i++) {
+    permTable[i] = perm(i);
+  }
+}
+
+// The vector paths do the same float operations as perlin(), in the same order, so results are bit identical.
+#if defined(NOISE_X86) && defined(__SSE2__)
+static inline __m128 floorSse2(__m128 v) {
+  // Truncate, then step down where truncation rounded a negative value up
+  __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 selectSse2(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// SSE2 has no gather, look the four lanes up one by one
+static inline __m128i permSse2(__m128i index) {
+  int32_t lanes[4];
+  _mm_storeu_si128((__m128i*)lanes, index);
+  return _mm_setr_epi32(permTable[lanes[0]], permTable[lanes[1]], permTable[lanes[2]], permTable[lanes[3]]);
+}
+
+static inline __m128 fadeSse2(__m128 t) {
+  __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+  return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerpSse2(__m128 a, __m128 b, __m128 t) {
+  return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+// Branch free grad(): the low hash bits pick the two gradient axes and their signs
+static inline __m128 gradSse2(__m128i hash, __m128 x, __m128 y, __m128 z) {
+  __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+  __m128 u = selectSse2(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8))), x, y);
+  __m128 xOrZ = selectSse2(_mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14)))), x, z);
+  __m128 v = selectSse2(_mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4))), y, xOrZ);
+  __m128 uSign = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+  __m128 vSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+  return _mm_add_ps(_mm_xor_ps(u, uSign), _mm_xor_ps(v, vSign));
+}
+
+static void perlinBatchSse2(const float* xs, float y, const float* zs, float* out, int count) {
+  const __m128i byteMask = _mm_set1_epi32(255);
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  // y is shared by every sample, so its part of the hash and blend is scalar
+  float yFloor = floorf(y);
+  __m128i Y = _mm_set1_epi32((int)yFloor & 255);
+  __m128 yf = _mm_set1_ps(y - yFloor);
+  __m128 yf1 = _mm_sub_ps(yf, one);
+  __m128 v = fadeSse2(yf);
+
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128 x = _mm_loadu_ps(xs + i);
+    __m128 z = _mm_loadu_ps(zs + i);
+    __m128 xFloor = floorSse2(x);
+    __m128 zFloor = floorSse2(z);
+    __m128i X = _mm_and_si128(_mm_cvttps_epi32(xFloor), byteMask);
+    __m128i Z = _mm_and_si128(_mm_cvttps_epi32(zFloor), byteMask);
+    x = _mm_sub_ps(x, xFloor);
+    z = _mm_sub_ps(z, zFloor);
+    __m128 x1 = _mm_sub_ps(x, one);
+    __m128 z1 = _mm_sub_ps(z, one);
+
+    __m128 u = fadeSse2(x);
+    __m128 w = fadeSse2(z);
+
+    __m128i oneI = _mm_set1_epi32(1);
+    __m128i A = _mm_add_epi32(permSse2(X), Y);
+    __m128i AA = _mm_add_epi32(permSse2(A), Z);
+    __m128i AB = _mm_add_epi32(permSse2(_mm_add_epi32(A, oneI)), Z);
+    __m128i B = _mm_add_epi32(permSse2(_mm_add_epi32(X, oneI)), Y);
+    __m128i BA = _mm_add_epi32(permSse2(B), Z);
+    __m128i BB = _mm_add_epi32(permSse2(_mm_add_epi32(B, oneI)), Z);
+
+    __m128 near = lerpSse2(lerpSse2(gradSse2(permSse2(AA), x, yf, z), gradSse2(permSse2(BA), x1, yf, z), u),
+                           lerpSse2(gradSse2(permSse2(AB), x, yf1, z), gradSse2(permSse2(BB), x1, yf1, z), u), v);
+    __m128 far = lerpSse2(lerpSse2(gradSse2(permSse2(_mm_add_epi32(AA, oneI)), x, yf, z1), gradSse2(permSse2(_mm_add_epi32(BA, oneI)), x1, yf, z1), u),
+                          lerpSse2(gradSse2(permSse2(_mm_add_epi32(AB, oneI)), x, yf1, z1), gradSse2(permSse2(_mm_add_epi32(BB, oneI)), x1, yf1, z1), u), v);
+    __m128 res = lerpSse2(near, far, w);
+    _mm_storeu_ps(out + i, _mm_div_ps(_mm_add_ps(res, one), _mm_set1_ps(2.0f)));
+  }
+  for (; i < count; i++) {
+    out[i] = perlin(xs[i], y, zs[i]);
+  }
+}
+#endif
+
+#ifdef NOISE_X86
+#define AVX2 __attribute__((target("avx2")))
+
+static inline AVX2 __m256 floorAvx2(__m256 v) {
+  return _mm256_floor_ps(v);
+}
+
+static inline AVX2 __m256i permAvx2(__m256i index) {
+  return _mm256_i32gather_epi32(permTable, index, 4);
+}
+
+static inline AVX2 __m256 fadeAvx2(__m256 t) {
+  __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+  return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(t, t), t), inner);
+}
+
+static inline AVX2 __m256 lerpAvx2(__m256 a, __m256 b, __m256 t) {
+  return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+static inline AVX2 __m256 gradAvx2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+  __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+  __m256 u = _mm256_blendv_ps(y, x, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h)));
+  __m256i is12or14 = _mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14)));
+  __m256 xOrZ = _mm256_blendv_ps(z, x, _mm256_castsi256_ps(is12or14));
+  __m256 v = _mm256_blendv_ps(xOrZ, y, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h)));
+  __m256 uSign = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+  __m256 vSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31));
+  return _mm256_add_ps(_mm256_xor_ps(u, uSign), _mm256_xor_ps(v, vSign));
+}
+
+static AVX2 void perlinBatchAvx2(const float* xs, float y, const float* zs, float* out, int count) {
+  const __m256i byteMask = _mm256_set1_epi32(255);
+  const __m256i oneI = _mm256_set1_epi32(1);
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  float yFloor = floorf(y);
+  __m256i Y = _mm256_set1_epi32((int)yFloor & 255);
+  __m256 yf = _mm256_set1_ps(y - yFloor);
+  __m256 yf1 = _mm256_sub_ps(yf, one);
+  __m256 v = fadeAvx2(yf);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    __m256 x = _mm256_loadu_ps(xs + i);
+    __m256 z = _mm256_loadu_ps(zs + i);
+    __m256 xFloor = floorAvx2(x);
+    __m256 zFloor = floorAvx2(z);
+    __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(xFloor), byteMask);
+    __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(zFloor), byteMask);
+    x = _mm256_sub_ps(x, xFloor);
+    z = _mm256_sub_ps(z, zFloor);
+    __m256 x1 = _mm256_sub_ps(x, one);
+    __m256 z1 = _mm256_sub_ps(z, one);
+
+    __m256 u = fadeAvx2(x);
+    __m256 w = fadeAvx2(z);
+
+    __m256i A = _mm256_add_epi32(permAvx2(X), Y);
+    __m256i AA = _mm256_add_epi32(permAvx2(A), Z);
+    __m256i AB = _mm256_add_epi32(permAvx2(_mm256_add_epi32(A, oneI)), Z);
+    __m256i B = _mm256_add_epi32(permAvx2(_mm256_add_epi32(X, oneI)), Y);
+    __m256i BA = _mm256_add_epi32(permAvx2(B), Z);
+    __m256i BB = _mm256_add_epi32(permAvx2(_mm256_add_epi32(B, oneI)), Z);
+
+    __m256 near = lerpAvx2(lerpAvx2(gradAvx2(permAvx2(AA), x, yf, z), gradAvx2(permAvx2(BA), x1, yf, z), u),
+                           lerpAvx2(gradAvx2(permAvx2(AB), x, yf1, z), gradAvx2(permAvx2(BB), x1, yf1, z), u), v);
+    __m256 far = lerpAvx2(lerpAvx2(gradAvx2(permAvx2(_mm256_add_epi32(AA, oneI)), x, yf, z1), gradAvx2(permAvx2(_mm256_add_epi32(BA, oneI)), x1, yf, z1), u),
+                          lerpAvx2(gradAvx2(permAvx2(_mm256_add_epi32(AB, oneI)), x, yf1, z1), gradAvx2(permAvx2(_mm256_add_epi32(BB, oneI)), x1, yf1, z1), u), v);
+    __m256 res = lerpAvx2(near, far, w);
+    _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_add_ps(res, one), _mm256_set1_ps(2.0f)));
+  }
+  for (; i < count; i++) {
+    out[i] = perlin(xs[i], y, zs[i]);
+  }
+}
+#endif
+
+static void perlinBatchScalar(const float* xs, float y, const float* zs, float* out, int count) {
+  for (int i = 0; i < count; i++) {
+    out[i] = perlin(xs[i], y, zs[i]);
+  }
+}
+
+typedef enum {
+  NOISE_SCALAR,
+  NOISE_SSE2,
+  NOISE_AVX2,
+} NoiseBackend;
+
+// Widest instruction set both the compiler and the CPU support
+static NoiseBackend getNoiseBackend() {
+#ifdef NOISE_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return NOISE_AVX2;
+  }
+#endif
+#if defined(NOISE_X86) && defined(__SSE2__)
+  return NOISE_SSE2;
+#else
+  return NOISE_SCALAR;
+#endif
+}
+
+// Safe to call from several threads at once, the worldgen workers all sample noise.
+void perlinBatch(const float* x, float y, const float* z, float* out, int count) {
+  pthread_once(&permTableOnce, initPermTable);
+  switch (getNoiseBackend()) {
+#ifdef NOISE_X86
+  case NOISE_AVX2:
+    perlinBatchAvx2(x, y, z, out, count);
+    break;
+#endif
+#if defined(NOISE_X86) && defined(__SSE2__)
+  case NOISE_SSE2:
+    perlinBatchSse2(x, y, z, out, count);
+    break;
+#endif
+  default:
+    perlinBatchScalar(x, y, z, out, count);
+    break;
+  }
+}
+
+const char* getPerlinBatchBackendText() {
+  switch (getNoiseBackend()) {
+  case NOISE_AVX2:
+    return "AVX2";
+  case NOISE_SSE2:
+    return "SSE2";
+  default:
+    return "Scalar";
+  }
+}
+
+typedef void (*PerlinBatchFunction)(const float* xs, float y, const float* zs, float* out, int count);
+
+// Points on both sides of zero and past the 256 wrap of the permutation table, an odd count runs the scalar tails too
+#define NOISE_CHECK_POINTS 203
+
+static bool checkPerlinBatch(const char* name, PerlinBatchFunction batch, const float* xs, const float* zs, const float* expected) {
+  float out[NOISE_CHECK_POINTS];
+  batch(xs, 0.0f, zs, out, NOISE_CHECK_POINTS);
+  for (int i = 0; i < NOISE_CHECK_POINTS; i++) {
+    if (out[i] != expected[i]) {
+      fprintf(stderr, "%s Perlin noise differs from perlin() at (%f, 0, %f): %f instead of %f\n", name, xs[i], zs[i], out[i], expected[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Compare every backend the CPU can run with perlin(), not only the one perlinBatch picks, and report mismatches.
+bool perlinBatchCheckBackends() {
+  pthread_once(&permTableOnce, initPermTable);
+  float xs[NOISE_CHECK_POINTS], zs[NOISE_CHECK_POINTS], expected[NOISE_CHECK_POINTS];
+  for (int i = 0; i < NOISE_CHECK_POINTS; i++) {
+    xs[i] = (i - NOISE_CHECK_POINTS / 2) * 3.137f + 0.25f;
+    zs[i] = (i * 37 % NOISE_CHECK_POINTS - NOISE_CHECK_POINTS / 2) * 2.713f - 0.5f;
+    expected[i] = perlin(xs[i], 0.0f, zs[i]);
+  }
+
+  bool matches = checkPerlinBatch("Scalar", perlinBatchScalar, xs, zs, expected);
+#if defined(NOISE_X86) && defined(__SSE2__)
+  matches &= checkPerlinBatch("SSE2", perlinBatchSse2, xs, zs, expected);
+#endif
+#ifdef NOISE_X86
+  if (__builtin_cpu_supports("avx2")) {
+    matches &= checkPerlinBatch("AVX2", perlinBatchAvx2, xs, zs, expected);
+  }
+#endif
+  return matches;
+}
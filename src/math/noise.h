@@ -0,0 +1,17 @@
+/**
+ * @file math/noise.h
+ * @brief Batched Perlin noise, vectorized with SSE2 and AVX2 where the CPU has them.
+ * @author frankischilling
+ * @date 2024-12-12
+ */
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stdbool.h>
+
+// Sample perlin(x[i], y, z[i]) for count points on one y slice, results match perlin() exactly.
+void perlinBatch(const float* x, float y, const float* z, float* out, int count);
+const char* getPerlinBatchBackendText();
+bool perlinBatchCheckBackends();
+
+#endif // NOISE_H
@@ -1,18 +1,56 @@
 #include "raycast.h"
+#include <math.h>
 
-Ray rayCast(const Camera* camera) {
-  Vec3 rayOrigin = camera->position;
+// Walk the blocks along the camera ray in order, visiting every block the ray crosses exactly once
+// (Amanatides & Woo grid traversal). Stops at the first non air block closer than maxReach.
+Ray rayCast(const Camera* camera, float maxReach) {
   Vec3 rayDirection = camera->front;
-
   vec3_normalize(&rayDirection, &rayDirection);
-  for (float t = 0.01f; t < 10; t += 0.1f) {
-    Vec3 rayPoint = {rayOrigin.x + rayDirection.x * t, rayOrigin.y + rayDirection.y * t, rayOrigin.z + rayDirection.z * t};
-    Vec3i blockPos = worldToBlock(&rayPoint);
-    Block* block = getBlock(&blockPos);
-    if (block && block->id != BLOCK_AIR) {
-      Ray hitRay = {1, rayPoint, blockPos};
-      return hitRay;
+
+  const float origin[3] = {camera->position.x, camera->position.y, camera->position.z};
+  const float direction[3] = {rayDirection.x, rayDirection.y, rayDirection.z};
+  int cell[3], step[3];
+  float tMax[3];   // Ray distance at which the next block boundary on each axis is crossed
+  float tDelta[3]; // Ray distance between two block boundaries on each axis
+
+  for (int axis = 0; axis < 3; axis++) {
+    // Blocks span [n, n + 1), floor keeps negative coordinates in the right block
+    cell[axis] = (int)floorf(origin[axis]);
+    if (direction[axis] > 0.0f) {
+      step[axis] = 1;
+      tMax[axis] = (cell[axis] + 1 - origin[axis]) / direction[axis];
+      tDelta[axis] = 1.0f / direction[axis];
+    } else if (direction[axis] < 0.0f) {
+      step[axis] = -1;
+      tMax[axis] = (origin[axis] - cell[axis]) / -direction[axis];
+      tDelta[axis] = -1.0f / direction[axis];
+    } else {
+      step[axis] = 0;
+      tMax[axis] = INFINITY;
+      tDelta[axis] = INFINITY;
     }
   }
-  return (Ray){0, VEC3_ZERO, VEC3_ZERO};
-}
\ No newline at end of file
+
+  float t = 0.0f;
+  int enteredAxis = -1; // Axis of the boundary crossed into the current block, -1 for the starting block
+  while (t <= maxReach) {
+    Vec3i blockPos = {cell[0], cell[1], cell[2]};
+    enum BlockID block = getBlock(&blockPos);
+    if (block != BLOCK_AIR) {
+      int normal[3] = {0, 0, 0};
+      if (enteredAxis >= 0) {
+        normal[enteredAxis] = -step[enteredAxis];
+      }
+      Vec3 hitPoint = {origin[0] + direction[0] * t, origin[1] + direction[1] * t, origin[2] + direction[2] * t};
+      return (Ray){true, hitPoint, blockPos, {normal[0], normal[1], normal[2]}, t, block};
+    }
+
+    // Step into the neighbor across the nearest boundary
+    int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+    t = tMax[axis];
+    cell[axis] += step[axis];
+    tMax[axis] += tDelta[axis];
+    enteredAxis = axis;
+  }
+  return (Ray){false, VEC3_ZERO, VEC3_ZERO, VEC3_ZERO, 0.0f, BLOCK_AIR};
+}
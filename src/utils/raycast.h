@@ -1,4 +1,3 @@
-
 #ifndef RAYCAST_H
 #define RAYCAST_H
 
@@ -6,12 +5,18 @@
 #include "../graphics/camera.h"
 #include "../world/world.h"
 #include "../math/math.h"
+
+#define RAYCAST_REACH 10.0f // Default distance in blocks the camera can pick blocks at
+
 typedef struct {
   bool hit;
-  Vec3 hitCoords;
-  Vec3i blockCoords;
+  Vec3 hitCoords;     // Point where the ray enters the hit block
+  Vec3i blockCoords;  // Block that was hit
+  Vec3i normal;       // Normal of the face the ray entered through, zero when the ray starts inside the block
+  float distance;     // Distance from the camera to hitCoords
+  enum BlockID block; // Id of the hit block
 } Ray;
 
-Ray rayCast(const Camera* camera);
+Ray rayCast(const Camera* camera, float maxReach);
 
-#endif // RAYCAST_H
\ No newline at end of file
+#endif // RAYCAST_H
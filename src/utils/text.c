@@ -13,11 +13,11 @@
 #include "../graphics/shader.h"
 #include "text.h"
 
-void renderText(GLuint shaderProgram, const char* text, float x, float y) {
-  glUseProgram(shaderProgram);
+void renderText(const ShaderProgram* shaderProgram, const char* text, float x, float y) {
+  glUseProgram(shaderProgram->id);
 
   // Set text color to white
-  glUniform3f(glGetUniformLocation(shaderProgram, "textColor"), 1.0f, 1.0f, 1.0f);
+  glUniform3f(shaderProgram->uniforms[UNIFORM_TEXT_COLOR], 1.0f, 1.0f, 1.0f);
 
   // For right-aligned text, calculate the width of the text
   float textWidth = 0;
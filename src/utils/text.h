@@ -10,7 +10,8 @@
 #define TEXT_H
 
 #include <GL/freeglut.h>
+#include "../graphics/shader.h"
 
-void renderText(GLuint shaderProgram, const char* text, float x, float y);
+void renderText(const ShaderProgram* shaderProgram, const char* text, float x, float y);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,164 @@
+/**
+ * @file utils/threadpool.c
+ * @brief Worker threads running background jobs, results are handed back to the main thread.
+ * @author frankischilling
+ * @version 0.1
+ * @date 2024-12-11
+ *
+ */
+#include "threadpool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static void queuePush(JobQueue* queue, Job* job) {
+  job->next = NULL;
+  if (queue->tail) {
+    queue->tail->next = job;
+  } else {
+    queue->head = job;
+  }
+  queue->tail = job;
+}
+
+static Job* queuePop(JobQueue* queue) {
+  Job* job = queue->head;
+  if (job) {
+    queue->head = job->next;
+    if (!queue->head) {
+      queue->tail = NULL;
+    }
+  }
+  return job;
+}
+
+static void* workerMain(void* arg) {
+  ThreadPool* pool = (ThreadPool*)arg;
+
+  for (;;) {
+    pthread_mutex_lock(&pool->pendingLock);
+    while (!pool->pending.head && !pool->stopping) {
+      pthread_cond_wait(&pool->pendingSignal, &pool->pendingLock);
+    }
+    // Pending work is still finished when stopping, so every job reaches its complete callback
+    Job* job = queuePop(&pool->pending);
+    pthread_mutex_unlock(&pool->pendingLock);
+    if (!job) {
+      return NULL;
+    }
+
+    job->run(job->data);
+
+    pthread_mutex_lock(&pool->finishedLock);
+    queuePush(&pool->finished, job);
+    pthread_mutex_unlock(&pool->finishedLock);
+  }
+}
+
+// Number of workers to start, one core is left to the main thread.
+int getWorkerThreadCount() {
+  long cores = 4;
+#ifdef _SC_NPROCESSORS_ONLN
+  cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return cores > 1 ? (int)cores - 1 : 1;
+}
+
+bool threadPoolInit(ThreadPool* pool, int threadCount) {
+  pool->pending = (JobQueue){NULL, NULL};
+  pool->finished = (JobQueue){NULL, NULL};
+  pool->activeJobs = 0;
+  pool->stopping = false;
+  pthread_mutex_init(&pool->pendingLock, NULL);
+  pthread_cond_init(&pool->pendingSignal, NULL);
+  pthread_mutex_init(&pool->finishedLock, NULL);
+
+  pool->threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+  pool->threadCount = 0;
+  if (!pool->threads) {
+    fprintf(stderr, "Failed to allocate %d worker threads\n", threadCount);
+    return false;
+  }
+  for (int i = 0; i < threadCount; i++) {
+    if (pthread_create(&pool->threads[pool->threadCount], NULL, workerMain, pool) != 0) {
+      fprintf(stderr, "Failed to start worker thread %d\n", i);
+      break;
+    }
+    pool->threadCount++;
+  }
+  return pool->threadCount > 0;
+}
+
+// Queue a job, jobs are picked up by the workers in submission order.
+void threadPoolSubmit(ThreadPool* pool, JobFunction run, JobFunction complete, void* data) {
+  Job* job = (Job*)malloc(sizeof(Job));
+  if (!job) {
+    fprintf(stderr, "Failed to allocate job\n");
+    return;
+  }
+  job->run = run;
+  job->complete = complete;
+  job->data = data;
+  pool->activeJobs++;
+
+  pthread_mutex_lock(&pool->pendingLock);
+  queuePush(&pool->pending, job);
+  pthread_cond_signal(&pool->pendingSignal);
+  pthread_mutex_unlock(&pool->pendingLock);
+}
+
+// Call complete for up to maxJobs finished jobs on the calling thread, all of them if maxJobs is negative.
+// Returns the number of jobs completed.
+int threadPoolPoll(ThreadPool* pool, int maxJobs) {
+  pthread_mutex_lock(&pool->finishedLock);
+  JobQueue finished = pool->finished;
+  pool->finished = (JobQueue){NULL, NULL};
+  pthread_mutex_unlock(&pool->finishedLock);
+
+  int completed = 0;
+  Job* job;
+  while ((maxJobs < 0 || completed < maxJobs) && (job = queuePop(&finished))) {
+    if (job->complete) {
+      job->complete(job->data);
+    }
+    free(job);
+    pool->activeJobs--;
+    completed++;
+  }
+
+  // Hand back whatever is over budget, ahead of jobs that finished in the meantime
+  if (finished.head) {
+    pthread_mutex_lock(&pool->finishedLock);
+    finished.tail->next = pool->finished.head;
+    if (!pool->finished.head) {
+      pool->finished.tail = finished.tail;
+    }
+    pool->finished.head = finished.head;
+    pthread_mutex_unlock(&pool->finishedLock);
+  }
+  return completed;
+}
+
+// Finish every submitted job, complete them on the calling thread and stop the workers.
+void threadPoolDestroy(ThreadPool* pool) {
+  pthread_mutex_lock(&pool->pendingLock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->pendingSignal);
+  pthread_mutex_unlock(&pool->pendingLock);
+
+  for (int i = 0; i < pool->threadCount; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  threadPoolPoll(pool, -1);
+  // Jobs submitted from a complete callback above, or to a pool without workers, never run
+  if (pool->activeJobs != 0) {
+    fprintf(stderr, "Thread pool stopped with %d jobs never completed\n", pool->activeJobs);
+  }
+
+  free(pool->threads);
+  pool->threads = NULL;
+  pool->threadCount = 0;
+  pthread_mutex_destroy(&pool->pendingLock);
+  pthread_cond_destroy(&pool->pendingSignal);
+  pthread_mutex_destroy(&pool->finishedLock);
+}
@@ -0,0 +1,47 @@
+/**
+ * @file utils/threadpool.h
+ * @brief Worker threads running background jobs, results are handed back to the main thread.
+ * @author frankischilling
+ * @version 0.1
+ * @date 2024-12-11
+ *
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef void (*JobFunction)(void* data);
+
+typedef struct Job {
+  JobFunction run;      // called on a worker thread
+  JobFunction complete; // called on the thread polling the pool once run returned
+  void* data;
+  struct Job* next;
+} Job;
+
+typedef struct {
+  Job* head;
+  Job* tail;
+} JobQueue;
+
+typedef struct {
+  pthread_t* threads;
+  int threadCount;
+  pthread_mutex_t pendingLock;
+  pthread_cond_t pendingSignal;
+  JobQueue pending; // waiting for a worker, oldest first
+  pthread_mutex_t finishedLock;
+  JobQueue finished; // waiting for complete to be called, in finishing order
+  int activeJobs;    // submitted jobs whose complete has not been called yet
+  bool stopping;
+} ThreadPool;
+
+int getWorkerThreadCount();
+bool threadPoolInit(ThreadPool* pool, int threadCount);
+void threadPoolSubmit(ThreadPool* pool, JobFunction run, JobFunction complete, void* data);
+int threadPoolPoll(ThreadPool* pool, int maxJobs);
+void threadPoolDestroy(ThreadPool* pool);
+
+#endif // THREADPOOL_H
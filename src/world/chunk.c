@@ -3,9 +3,56 @@
 #include "cube.h"
 #include "world.h"
 #include <stdio.h>
+#include <string.h>
+
+// Fill every section of a new chunk with air.
+void chunkInitBlocks(Chunk* chunk) {
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    sectionInit(&chunk->sections[s], BLOCK_AIR);
+  }
+  memset(chunk->solidColumns, 0, sizeof(chunk->solidColumns));
+}
+
+void chunkFreeBlocks(Chunk* chunk) {
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    sectionFree(&chunk->sections[s]);
+  }
+}
+
+// Bytes used by the chunk and its block storage.
+size_t chunkMemoryUsage(const Chunk* chunk) {
+  size_t bytes = sizeof(Chunk) - sizeof(chunk->sections);
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    bytes += sectionMemoryUsage(&chunk->sections[s]);
+  }
+  return bytes;
+}
+
+// Get the world space box around the non empty sections of the chunk.
+// Returns false when every section is empty.
+bool chunkGetSolidBounds(const Chunk* chunk, Vec3* center, Vec3* dimensions) {
+  int lowest = CHUNK_SECTIONS;
+  int highest = -1;
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    if (sectionGetState(&chunk->sections[s]) != SECTION_EMPTY) {
+      lowest = s < lowest ? s : lowest;
+      highest = s;
+    }
+  }
+  if (highest < 0) {
+    return false;
+  }
+
+  Vec3 chunkCenter = getChunkCenter(&chunk->position);
+  float bottom = lowest * SECTION_HEIGHT * CUBE_SIZE;
+  float top = (highest + 1) * SECTION_HEIGHT * CUBE_SIZE;
+  *center = (Vec3){chunkCenter.x, (bottom + top) / 2, chunkCenter.z};
+  *dimensions = (Vec3){CHUNK_SIZE * CUBE_SIZE, top - bottom, CHUNK_SIZE * CUBE_SIZE};
+  return true;
+}
 
 // Convert chunk coordinates to world space.
-Vec3 chunkToWorld(Vec2i* chunkPos) {
+Vec3 chunkToWorld(const Vec2i* chunkPos) {
   return (Vec3){
       chunkPos->a * CHUNK_SIZE,
       0,
@@ -14,7 +61,7 @@ Vec3 chunkToWorld(Vec2i* chunkPos) {
 }
 
 // Get the chunk position in world space (centered).
-Vec3 getChunkCenter(Vec2i* chunkPos) {
+Vec3 getChunkCenter(const Vec2i* chunkPos) {
   Vec3 worldCoords = chunkToWorld(chunkPos);
   return (Vec3){
       worldCoords.x + CHUNK_SIZE / 2,
@@ -52,8 +99,8 @@ Vec2i worldToChunk(Vec3* worldPos) {
 // Convert block coordinates to chunk coordinates.
 Vec2i blockToChunk(Vec3i* blockPos) {
   return (Vec2i){
-      (int)(floorf(blockPos->x / (CHUNK_SIZE * CUBE_SIZE)) + CHUNKS_PER_AXIS / 2),
-      (int)(floorf(blockPos->z / (CHUNK_SIZE * CUBE_SIZE)) + CHUNKS_PER_AXIS / 2),
+      (int)floorf(blockPos->x / (CHUNK_SIZE * CUBE_SIZE)),
+      (int)floorf(blockPos->z / (CHUNK_SIZE * CUBE_SIZE)),
   };
 }
 
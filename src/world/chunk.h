@@ -2,32 +2,83 @@
 #define CHUNK_H
 
 #include "cube.h"
+#include "mesh.h"
+#include "section.h"
 
 #define CHUNK_SIZE 16   // block count
 #define CHUNK_HEIGHT 64 // block count
-#define CHUNKS_PER_AXIS WORLD_SIZE / CHUNK_SIZE
+#define CHUNK_SECTIONS (CHUNK_HEIGHT / SECTION_HEIGHT)
+#define CHUNK_ALL_SECTIONS ((1u << CHUNK_SECTIONS) - 1) // Section mask with every section set
 #define CHUNK_DIMENSIONS                                                                                                                                                           \
   (Vec3) {                                                                                                                                                                         \
     CHUNK_SIZE *CUBE_SIZE, CHUNK_HEIGHT *CUBE_SIZE, CHUNK_SIZE *CUBE_SIZE,                                                                                                         \
   }
 
+// Faces of a section that see each other through air, bit a * 6 + b is set when air
+// entering through face a can leave through face b. Face numbers follow vec3iFaceMap.
+typedef uint64_t SectionConnectivity;
+#define SECTION_ALL_CONNECTED ((((SectionConnectivity)1) << 36) - 1)
+
+static inline bool sectionFacesConnected(SectionConnectivity connectivity, int a, int b) {
+  return connectivity >> (a * 6 + b) & 1;
+}
+
 typedef enum {
   BIOME_PLAINS,
   BIOME_HILLS,
 } BiomeID;
 
+typedef enum {
+  CHUNK_GENERATING, // Blocks are being written by a worker thread, only the position may be read
+  CHUNK_READY,
+} ChunkState;
+
+_Static_assert(SECTION_SIZE == CHUNK_SIZE, "sections must span the whole chunk horizontally");
+_Static_assert(CHUNK_HEIGHT <= 64, "a column must fit in one solid mask");
+
 typedef struct {
-  Block blocks[CHUNK_SIZE][CHUNK_HEIGHT][CHUNK_SIZE];
+  ChunkSection sections[CHUNK_SECTIONS];           // Blocks, bottom section first
+  uint64_t solidColumns[CHUNK_SIZE][CHUNK_SIZE]; // Per [x][z] column, bit y is set where the block is not air
   Vec2i position; // Chunk coordinates
   BiomeID id;
+  ChunkMesh meshes[CHUNK_SECTIONS]; // One mesh per section, so an edit only rebuilds the sections it touches
+  unsigned dirtySections;          // Bit s is set when the mesh of section s needs to be rebuilt from blocks
+  SectionConnectivity connectivity[CHUNK_SECTIONS]; // Updated with the section meshes, all connected until the first build
+  unsigned visitFrame[CHUNK_SECTIONS];               // Frame in which the visibility walk last reached the section
+  GLuint occlusionQuery;    // Bounding box query, 0 until the chunk is first tested
+  bool occlusionPending;    // Query issued and its result not read yet
+  bool occluded;            // No sample of the bounding box passed the depth test in the last read result
+  unsigned occlusionFrame;  // Frame the chunk was last tested in, older results are not trusted
+  unsigned version;  // Bumped on every change that makes a mesh stale, older mesh builds are dropped
+  int meshJobs;      // Mesh builds of this chunk that are running or waiting for upload
+  ChunkState state;
+  bool unloaded;     // Left the world while a worker still uses it, freed once the workers are done
 } Chunk;
 
-Vec3 chunkToWorld(Vec2i* chunkPos);
-Vec3 getChunkCenter(Vec2i* chunkPos);
+Vec3 chunkToWorld(const Vec2i* chunkPos);
+Vec3 getChunkCenter(const Vec2i* chunkPos);
 Vec3 blockToWorld(Vec3i* blockPos);
 Vec2i worldToChunk(Vec3* worldPos);
 Vec2i blockToChunk(Vec3i* blockPos);
 Vec3i getLocal(Vec3i* blockPos);
 Vec3i worldToBlock(Vec3* worldPos);
 
+void chunkInitBlocks(Chunk* chunk);
+void chunkFreeBlocks(Chunk* chunk);
+size_t chunkMemoryUsage(const Chunk* chunk);
+bool chunkGetSolidBounds(const Chunk* chunk, Vec3* center, Vec3* dimensions);
+
+// Get the block at a local position, which must be inside the chunk.
+static inline enum BlockID chunkGetBlock(const Chunk* chunk, int x, int y, int z) {
+  return sectionGetBlock(&chunk->sections[y / SECTION_HEIGHT], x, y % SECTION_HEIGHT, z);
+}
+
+// Set the block at a local position, which must be inside the chunk.
+// Keeps the solid mask of the edited column in step with the blocks.
+static inline void chunkSetBlock(Chunk* chunk, int x, int y, int z, enum BlockID id) {
+  sectionSetBlock(&chunk->sections[y / SECTION_HEIGHT], x, y % SECTION_HEIGHT, z, id);
+  uint64_t bit = (uint64_t)1 << y;
+  chunk->solidColumns[x][z] = id != BLOCK_AIR ? chunk->solidColumns[x][z] | bit : chunk->solidColumns[x][z] & ~bit;
+}
+
 #endif // CHUNK_H
\ No newline at end of file
@@ -0,0 +1,127 @@
+/**
+ * @file world/chunkmap.c
+ * @brief Open addressing hash map from chunk coordinates to loaded chunks.
+ * @author frankischilling
+ * @date 2024-12-09
+ */
+#include "chunkmap.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Grow once more than half of the slots are used, keeping probe sequences short
+#define CHUNK_MAP_MAX_LOAD_NUM 1
+#define CHUNK_MAP_MAX_LOAD_DEN 2
+
+static uint32_t hashChunkPos(const Vec2i* key) {
+  uint32_t h = (uint32_t)key->a * 0x9E3779B1u ^ (uint32_t)key->b * 0x85EBCA77u;
+  h ^= h >> 16;
+  h *= 0x7FEB352Du;
+  h ^= h >> 15;
+  return h;
+}
+
+// Find the slot holding key, or the free slot where it would be inserted.
+static int findSlot(const ChunkMap* map, const Vec2i* key) {
+  int mask = map->capacity - 1;
+  int i = hashChunkPos(key) & mask;
+  while (map->slots[i].chunk && (map->slots[i].key.a != key->a || map->slots[i].key.b != key->b)) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+static bool chunkMapResize(ChunkMap* map, int capacity) {
+  ChunkMapSlot* slots = (ChunkMapSlot*)calloc(capacity, sizeof(ChunkMapSlot));
+  if (!slots) {
+    fprintf(stderr, "Failed to allocate chunk map with %d slots\n", capacity);
+    return false;
+  }
+
+  ChunkMapSlot* oldSlots = map->slots;
+  int oldCapacity = map->capacity;
+  map->slots = slots;
+  map->capacity = capacity;
+  for (int i = 0; i < oldCapacity; i++) {
+    if (oldSlots[i].chunk) {
+      map->slots[findSlot(map, &oldSlots[i].key)] = oldSlots[i];
+    }
+  }
+  free(oldSlots);
+  return true;
+}
+
+void chunkMapInit(ChunkMap* map, int capacity) {
+  int size = 16;
+  while (size < capacity) {
+    size *= 2;
+  }
+  map->slots = NULL;
+  map->capacity = 0;
+  map->count = 0;
+  chunkMapResize(map, size);
+}
+
+// Release the slot array, the chunks themselves belong to the caller.
+void chunkMapFree(ChunkMap* map) {
+  free(map->slots);
+  map->slots = NULL;
+  map->capacity = 0;
+  map->count = 0;
+}
+
+Chunk* chunkMapGet(const ChunkMap* map, const Vec2i* key) {
+  return map->slots[findSlot(map, key)].chunk;
+}
+
+// Insert a chunk keyed by its position. Fails if a chunk is already stored there.
+bool chunkMapInsert(ChunkMap* map, Chunk* chunk) {
+  if ((map->count + 1) * CHUNK_MAP_MAX_LOAD_DEN > map->capacity * CHUNK_MAP_MAX_LOAD_NUM && !chunkMapResize(map, map->capacity * 2)) {
+    return false;
+  }
+
+  int i = findSlot(map, &chunk->position);
+  if (map->slots[i].chunk) {
+    return false;
+  }
+  map->slots[i].key = chunk->position;
+  map->slots[i].chunk = chunk;
+  map->count++;
+  return true;
+}
+
+// Remove and return the chunk stored at key, NULL if there is none.
+Chunk* chunkMapRemove(ChunkMap* map, const Vec2i* key) {
+  int mask = map->capacity - 1;
+  int i = findSlot(map, key);
+  Chunk* chunk = map->slots[i].chunk;
+  if (!chunk) {
+    return NULL;
+  }
+
+  // Shift later entries of the probe sequence back instead of leaving a tombstone
+  int hole = i;
+  for (int j = (i + 1) & mask; map->slots[j].chunk; j = (j + 1) & mask) {
+    int home = hashChunkPos(&map->slots[j].key) & mask;
+    // Move the entry unless its home slot lies cyclically between the hole and its current slot
+    bool between = hole <= j ? (home > hole && home <= j) : (home > hole || home <= j);
+    if (!between) {
+      map->slots[hole] = map->slots[j];
+      hole = j;
+    }
+  }
+  map->slots[hole].chunk = NULL;
+  map->count--;
+  return chunk;
+}
+
+// Iterate over all stored chunks, start with *iterator = 0. Returns NULL after the last chunk.
+Chunk* chunkMapNext(const ChunkMap* map, int* iterator) {
+  while (*iterator < map->capacity) {
+    Chunk* chunk = map->slots[(*iterator)++].chunk;
+    if (chunk) {
+      return chunk;
+    }
+  }
+  return NULL;
+}
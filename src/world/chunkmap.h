@@ -0,0 +1,33 @@
+/**
+ * @file world/chunkmap.h
+ * @brief Open addressing hash map from chunk coordinates to loaded chunks.
+ * @author frankischilling
+ * @date 2024-12-09
+ */
+#ifndef CHUNKMAP_H
+#define CHUNKMAP_H
+
+#include <stdbool.h>
+#include "chunk.h"
+
+// Slots are probed linearly, so a lookup walks consecutive memory.
+// The map only stores pointers, chunks never move while they are loaded.
+typedef struct {
+  Vec2i key;
+  Chunk* chunk; // NULL for a free slot
+} ChunkMapSlot;
+
+typedef struct {
+  ChunkMapSlot* slots;
+  int capacity; // power of two
+  int count;
+} ChunkMap;
+
+void chunkMapInit(ChunkMap* map, int capacity);
+void chunkMapFree(ChunkMap* map);
+Chunk* chunkMapGet(const ChunkMap* map, const Vec2i* key);
+bool chunkMapInsert(ChunkMap* map, Chunk* chunk);
+Chunk* chunkMapRemove(ChunkMap* map, const Vec2i* key);
+Chunk* chunkMapNext(const ChunkMap* map, int* iterator);
+
+#endif // CHUNKMAP_H
@@ -16,15 +16,9 @@ enum BlockID {
   BLOCK_GRASS = 1,
   BLOCK_DIRT = 2,
   BLOCK_STONE = 3,
+  BLOCK_ID_COUNT,
 };
 
-// block struct
-typedef struct {
-  enum BlockID id;
-  bool checkedNeighbors;
-  bool neighbor[6];
-} Block;
-
 // Block colors (R0.GB)
 static const Vec3 blockColors[] = {
     {0.0f, 0.0f, 0.0f}, // AIR (not used)
@@ -32,7 +26,20 @@ static const Vec3 blockColors[] = {
     {0.6f, 0.4f, 0.2f}, // DIRT
     {0.5f, 0.5f, 0.5f}  // STONE
 };
-void initCube();
-void renderCubeFace(int face, GLuint texture);
+
+// Textures a block face can be drawn with
+enum BlockTexture {
+  TEXTURE_STONE = 0,
+  TEXTURE_DIRT = 1,
+  TEXTURE_GRASS_TOP = 2,
+  TEXTURE_GRASS_SIDE = 3,
+  BLOCK_TEXTURE_COUNT,
+};
+
+#define CUBE_FACE_VERTICES 6 // two triangles per face
+#define CUBE_VERTEX_FLOATS 8 // position, normal, texture coords
+
+const GLfloat* getCubeFaceVertices(int face);
+enum BlockTexture getBlockFaceTexture(enum BlockID id, int face);
 
 #endif // CUBE_H
\ No newline at end of file
@@ -0,0 +1,340 @@
+/**
+ * @file world/mesh.c
+ * @brief Prebuilt chunk meshes stored in GPU buffers.
+ * @author frankischilling
+ * @date 2024-12-07
+ */
+#include "mesh.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void meshBuilderReset(MeshBuilder* builder) {
+  builder->vertexCount = 0;
+  builder->faceCount = 0;
+  builder->blockCount = 0;
+}
+
+void meshBuilderFree(MeshBuilder* builder) {
+  free(builder->vertices);
+  free(builder->faces);
+  *builder = (MeshBuilder){0};
+}
+
+// Axes the texture u and v coordinates run along for each face (0 = x, 1 = y, 2 = z)
+static const int faceTextureAxes[6][2] = {
+    {2, 1}, // Right
+    {2, 1}, // Left
+    {0, 2}, // Top
+    {0, 2}, // Bottom
+    {0, 1}, // Front
+    {0, 1}, // Back
+};
+
+// Store a quad as a single face record, the shader rebuilds its vertices.
+static void meshBuilderAddFace(MeshBuilder* builder, int face, enum BlockTexture texture, const Vec3i* origin, const Vec3i* size, unsigned ao) {
+  if (builder->faceCount == builder->faceCapacity) {
+    int capacity = builder->faceCapacity ? builder->faceCapacity * 2 : 1024;
+    FaceRecord* faces = (FaceRecord*)realloc(builder->faces, capacity * sizeof(FaceRecord));
+    if (!faces) {
+      fprintf(stderr, "Failed to grow mesh builder to %d faces\n", capacity);
+      return;
+    }
+    builder->faces = faces;
+    builder->faceCapacity = capacity;
+  }
+
+  FaceRecord* record = &builder->faces[builder->faceCount++];
+  record->position = (uint32_t)origin->x | (uint32_t)origin->y << 5 | (uint32_t)origin->z << 12 | (uint32_t)face << 17 | (uint32_t)ao << 20;
+  record->extent = (uint32_t)(size->x - 1) | (uint32_t)(size->y - 1) << 4 | (uint32_t)(size->z - 1) << 10 | (uint32_t)texture << 14;
+}
+
+// Append one face of the box of blocks starting at origin, in chunk local block coordinates.
+// The box is one block deep along the face normal, texture coordinates repeat once per block.
+// ao holds the ambient occlusion of the quad corners, see QUAD_AO_OPEN.
+void meshBuilderAddQuad(MeshBuilder* builder, int face, enum BlockTexture texture, const Vec3i* origin, const Vec3i* size, unsigned ao) {
+  if (builder->path == RENDER_FACES) {
+    meshBuilderAddFace(builder, face, texture, origin, size, ao);
+    return;
+  }
+
+  if (builder->vertexCount + CUBE_FACE_VERTICES > builder->capacity) {
+    int capacity = builder->capacity ? builder->capacity * 2 : 4096;
+    MeshVertex* vertices = (MeshVertex*)realloc(builder->vertices, capacity * sizeof(MeshVertex));
+    if (!vertices) {
+      fprintf(stderr, "Failed to grow mesh builder to %d vertices\n", capacity);
+      return;
+    }
+    builder->vertices = vertices;
+    builder->capacity = capacity;
+  }
+
+  const int extent[3] = {size->x, size->y, size->z};
+  const int start[3] = {origin->x, origin->y, origin->z};
+  const GLfloat* src = getCubeFaceVertices(face);
+  int planeAxis0 = face / 2 == 0 ? 1 : 0; // Axes in the face plane, in the order QUAD_AO_OPEN numbers corners by
+  int planeAxis1 = face / 2 == 2 ? 1 : 2;
+  MeshVertex* dst = builder->vertices + builder->vertexCount;
+  for (int v = 0; v < CUBE_FACE_VERTICES; v++) {
+    const GLfloat* vertex = src + v * CUBE_VERTEX_FLOATS;
+    // Cube corners are at +-0.5, so each axis picks either the start or the end of the box
+    uint32_t corner[3];
+    for (int axis = 0; axis < 3; axis++) {
+      corner[axis] = start[axis] + (vertex[axis] > 0.0f ? extent[axis] : 0);
+    }
+    uint32_t u = vertex[6] > 0.0f ? extent[faceTextureAxes[face][0]] : 0;
+    uint32_t w = vertex[7] > 0.0f ? extent[faceTextureAxes[face][1]] : 0;
+    int aoCorner = (vertex[planeAxis0] > 0.0f) | (vertex[planeAxis1] > 0.0f) << 1;
+    dst[v].position = corner[0] | corner[1] << 5 | corner[2] << 12 | (uint32_t)face << 17 | (ao >> (2 * aoCorner) & 3) << 20;
+    dst[v].texture = u | w << 7 | (uint32_t)texture << 14;
+  }
+  builder->vertexCount += CUBE_FACE_VERTICES;
+}
+
+// Bytes of vertex data an upload of the builder sends to the GPU.
+size_t meshBuilderByteSize(const MeshBuilder* builder) {
+  if (builder->path == RENDER_FACES) {
+    return (size_t)builder->faceCount * sizeof(FaceRecord);
+  }
+  return (size_t)builder->vertexCount * sizeof(MeshVertex);
+}
+
+#define MESH_ARENA_CAPACITY (1 << 22) // Initial arena size in vertices or face records, 32 MB
+
+// Multi draw indirect command layout fixed by OpenGL
+typedef struct {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint first;
+  GLuint baseInstance;
+} DrawArraysIndirectCommand;
+
+// Draws of one render path collected during a frame
+typedef struct {
+  DrawArraysIndirectCommand* commands;
+  GLint* firsts; // glMultiDrawArrays arguments when indirect draws are unavailable
+  GLsizei* counts;
+  int count;
+  int capacity;
+} DrawQueue;
+
+static GpuArena arena;
+static GLuint vertexArrays[RENDER_PATH_COUNT];
+static unsigned vertexArrayGeneration; // Arena generation the vertex path VAO points at
+
+// One world origin per arena page, so shaders find the chunk of any vertex or face record without a draw id
+static GLfloat (*pages)[4];
+static int pageCount;
+static GLuint pageBuffer;
+static GLuint pageTexture;
+static unsigned pageGeneration; // Arena generation the page table was built for
+
+static DrawQueue drawQueues[RENDER_PATH_COUNT];
+static GLuint indirectBuffer;
+static bool multiDrawIndirect;
+
+// Create the arena every chunk mesh lives in. Needs a current GL context.
+void chunkMeshesInit() {
+  if (!gpuArenaInit(&arena, sizeof(MeshVertex), MESH_PAGE_SIZE, GL_RG32UI, MESH_ARENA_CAPACITY)) {
+    fprintf(stderr, "Failed to create the chunk mesh arena\n");
+  }
+  // The face path reads no vertex attributes, its VAO stays empty
+  glGenVertexArrays(RENDER_PATH_COUNT, vertexArrays);
+  vertexArrayGeneration = arena.generation - 1;
+
+  glGenBuffers(1, &pageBuffer);
+  glGenTextures(1, &pageTexture);
+  pageGeneration = arena.generation - 1;
+
+  multiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+  if (multiDrawIndirect) {
+    glGenBuffers(1, &indirectBuffer);
+  }
+}
+
+void chunkMeshesCleanup() {
+  glDeleteVertexArrays(RENDER_PATH_COUNT, vertexArrays);
+  glDeleteBuffers(1, &pageBuffer);
+  glDeleteTextures(1, &pageTexture);
+  if (indirectBuffer != 0) {
+    glDeleteBuffers(1, &indirectBuffer);
+  }
+  for (int path = 0; path < RENDER_PATH_COUNT; path++) {
+    free(drawQueues[path].commands);
+    free(drawQueues[path].firsts);
+    free(drawQueues[path].counts);
+    drawQueues[path] = (DrawQueue){0};
+  }
+  free(pages);
+  pages = NULL;
+  pageCount = 0;
+  gpuArenaDestroy(&arena);
+}
+
+static void writePages(const ChunkMesh* mesh) {
+  int first = mesh->range.offset / MESH_PAGE_SIZE;
+  int last = first + gpuArenaReservedCount(&arena, &mesh->range) / MESH_PAGE_SIZE;
+  for (int page = first; page < last; page++) {
+    pages[page][0] = mesh->origin.x;
+    pages[page][1] = mesh->origin.y;
+    pages[page][2] = mesh->origin.z;
+    pages[page][3] = 0.0f;
+  }
+}
+
+// Rebuild the whole page table after the arena moved or resized its ranges, otherwise write the pages of one mesh.
+static void updatePages(const ChunkMesh* mesh) {
+  if (pageGeneration != arena.generation) {
+    int count = arena.capacity / MESH_PAGE_SIZE;
+    if (count != pageCount) {
+      GLfloat(*resized)[4] = realloc(pages, count * sizeof(*pages));
+      if (!resized) {
+        fprintf(stderr, "Failed to grow chunk mesh page table to %d pages\n", count);
+        return;
+      }
+      pages = resized;
+      pageCount = count;
+    }
+    // Ranges are embedded in their ChunkMesh, which holds the origin
+    for (int i = 0; i < arena.liveCount; i++) {
+      writePages((const ChunkMesh*)((const char*)arena.live[i] - offsetof(ChunkMesh, range)));
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, pageBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, pageCount * sizeof(*pages), pages, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_BUFFER, pageTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, pageBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    pageGeneration = arena.generation;
+    return;
+  }
+
+  if (mesh && mesh->range.slot != 0) {
+    writePages(mesh);
+    int first = mesh->range.offset / MESH_PAGE_SIZE;
+    int count = gpuArenaReservedCount(&arena, &mesh->range) / MESH_PAGE_SIZE;
+    glBindBuffer(GL_TEXTURE_BUFFER, pageBuffer);
+    glBufferSubData(GL_TEXTURE_BUFFER, first * sizeof(*pages), count * sizeof(*pages), pages[first]);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+}
+
+// Bind the arena for drawing meshes of one path.
+// Face records are read from texture unit 1 and the page table from unit 2, where the chunk shaders expect them.
+static void bindArena(RenderPath path) {
+  glBindVertexArray(vertexArrays[path]);
+  if (path == RENDER_FACES) {
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, arena.texture);
+  } else if (vertexArrayGeneration != arena.generation) {
+    // Growing or compacting the arena replaces its buffer
+    glBindBuffer(GL_ARRAY_BUFFER, arena.buffer);
+    // Both packed words as one integer attribute, the shader unpacks them
+    glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(MeshVertex), (GLvoid*)0);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertexArrayGeneration = arena.generation;
+  }
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_BUFFER, pageTexture);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+GpuArenaStats chunkMeshGetArenaStats() {
+  return gpuArenaGetStats(&arena);
+}
+
+// Replace the contents of the mesh with the vertices collected by the builder.
+// origin is the world position of the chunk, shaders add it to the chunk local vertex positions.
+void chunkMeshUpload(ChunkMesh* mesh, const MeshBuilder* builder, const Vec3* origin) {
+  gpuArenaFree(&arena, &mesh->range);
+
+  int count = builder->path == RENDER_FACES ? builder->faceCount : builder->vertexCount;
+  if (!gpuArenaAlloc(&arena, &mesh->range, count)) {
+    mesh->vertexCount = 0;
+    return;
+  }
+  gpuArenaUpload(&arena, &mesh->range, builder->path == RENDER_FACES ? (const void*)builder->faces : (const void*)builder->vertices);
+
+  mesh->origin = *origin;
+  mesh->path = builder->path;
+  mesh->vertexCount = builder->path == RENDER_FACES ? builder->faceCount * CUBE_FACE_VERTICES : builder->vertexCount;
+  mesh->blockCount = builder->blockCount;
+  updatePages(mesh);
+}
+
+// Add the mesh to the draws of its render path, chunkMeshDrawQueued submits them all at once.
+void chunkMeshQueueDraw(const ChunkMesh* mesh) {
+  if (mesh->vertexCount == 0) {
+    return;
+  }
+
+  DrawQueue* queue = &drawQueues[mesh->path];
+  if (queue->count == queue->capacity) {
+    int capacity = queue->capacity ? queue->capacity * 2 : 256;
+    DrawArraysIndirectCommand* commands = (DrawArraysIndirectCommand*)realloc(queue->commands, capacity * sizeof(DrawArraysIndirectCommand));
+    GLint* firsts = (GLint*)realloc(queue->firsts, capacity * sizeof(GLint));
+    GLsizei* counts = (GLsizei*)realloc(queue->counts, capacity * sizeof(GLsizei));
+    if (commands) {
+      queue->commands = commands;
+    }
+    if (firsts) {
+      queue->firsts = firsts;
+    }
+    if (counts) {
+      queue->counts = counts;
+    }
+    if (!commands || !firsts || !counts) {
+      fprintf(stderr, "Failed to grow chunk draw queue to %d draws\n", capacity);
+      return;
+    }
+    queue->capacity = capacity;
+  }
+
+  // gl_VertexID counts from first, so face records are found at first / 6 without any extra uniform
+  int first = mesh->path == RENDER_FACES ? mesh->range.offset * CUBE_FACE_VERTICES : mesh->range.offset;
+  queue->commands[queue->count] = (DrawArraysIndirectCommand){(GLuint)mesh->vertexCount, 1, (GLuint)first, 0};
+  queue->firsts[queue->count] = first;
+  queue->counts[queue->count] = mesh->vertexCount;
+  queue->count++;
+}
+
+// Draw every queued mesh of one render path with a single call, the path's shader must be in use
+// and the block texture array bound. Returns the number of meshes drawn and empties the queue.
+int chunkMeshDrawQueued(RenderPath path) {
+  DrawQueue* queue = &drawQueues[path];
+  int drawn = queue->count;
+  if (drawn == 0) {
+    return 0;
+  }
+
+  updatePages(NULL);
+  bindArena(path);
+  if (multiDrawIndirect) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, drawn * sizeof(DrawArraysIndirectCommand), queue->commands, GL_STREAM_DRAW);
+    glMultiDrawArraysIndirect(GL_TRIANGLES, (const void*)0, drawn, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  } else {
+    glMultiDrawArrays(GL_TRIANGLES, queue->firsts, queue->counts, drawn);
+  }
+  glBindVertexArray(0);
+
+  queue->count = 0;
+  return drawn;
+}
+
+void chunkMeshDestroy(ChunkMesh* mesh) {
+  gpuArenaFree(&arena, &mesh->range);
+  *mesh = (ChunkMesh){0};
+  updatePages(NULL); // Freeing can compact the arena
+}
+
+const char* getRenderPathText(RenderPath path) {
+  switch (path) {
+  case RENDER_FACES:
+    return "Faces";
+  case RENDER_VERTICES:
+  default:
+    return "Vertices";
+  }
+}
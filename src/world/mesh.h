@@ -0,0 +1,87 @@
+/**
+ * @file world/mesh.h
+ * @brief Prebuilt chunk meshes stored in GPU buffers.
+ * @author frankischilling
+ * @date 2024-12-07
+ */
+#ifndef MESH_H
+#define MESH_H
+
+#include <GL/glew.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "../graphics/arena.h"
+#include "cube.h"
+
+#define MESH_PAGE_SIZE 128 // Arena elements per page table entry, chunk meshes start on a page boundary
+
+// Chunk mesh vertex packed into two 32 bit words, unpacked in voxel_vertex_shader.glsl
+//   position: x (5 bits) | y (7 bits) << 5 | z (5 bits) << 12 | face (3 bits) << 17 | ambient occlusion (2 bits) << 20
+//   texture:  u (7 bits) | v (7 bits) << 7 | texture array layer (8 bits) << 14
+// Positions are chunk local block corners, texture coordinates count repeats of the block texture.
+// Ambient occlusion runs from 0, a corner closed in by solid blocks, to 3, a fully lit corner.
+typedef struct {
+  uint32_t position;
+  uint32_t texture;
+} MeshVertex;
+
+_Static_assert(sizeof(MeshVertex) == 8, "mesh vertices must stay packed");
+
+// One quad of a chunk mesh, expanded into its 6 vertices by face_vertex_shader.glsl through gl_VertexID
+//   position: x (5 bits) | y (7 bits) << 5 | z (5 bits) << 12 | face (3 bits) << 17 | ambient occlusion (8 bits) << 20
+//   extent:   size x - 1 (4 bits) | size y - 1 (6 bits) << 4 | size z - 1 (4 bits) << 10 | texture array layer (8 bits) << 14
+typedef struct {
+  uint32_t position;
+  uint32_t extent;
+} FaceRecord;
+
+_Static_assert(sizeof(FaceRecord) == 8, "face records must stay packed");
+
+// Ambient occlusion of the four corners of a quad, 2 bits per corner as in MeshVertex. Corner c sits at the
+// far end of the lower numbered axis in the face plane when bit 0 of c is set, and of the other axis when bit 1 is set.
+#define QUAD_AO_OPEN 0xFFu // Every corner fully lit
+
+// How chunk geometry reaches the GPU
+typedef enum {
+  RENDER_VERTICES, // 6 packed vertices per quad in a vertex buffer
+  RENDER_FACES,    // 1 face record per quad in a buffer texture, vertices are pulled in the shader
+  RENDER_PATH_COUNT,
+} RenderPath;
+
+// CPU side geometry of a chunk, every texture lives in one texture array so a chunk is a single draw
+typedef struct {
+  RenderPath path; // Decides whether quads are stored as vertices or face records
+  MeshVertex* vertices;
+  int vertexCount;
+  int capacity; // in vertices
+  FaceRecord* faces;
+  int faceCount;
+  int faceCapacity;
+  int blockCount; // blocks with at least one exposed face
+} MeshBuilder;
+
+// GPU side mesh of a chunk, a range of the shared chunk mesh arena.
+// Vertices and face records are both 8 bytes, so one arena holds meshes of either path.
+typedef struct {
+  GpuRange range; // Vertices or face records, depending on path
+  Vec3 origin;    // World position of the chunk, stored in the page table of every page of range
+  RenderPath path;
+  int vertexCount; // Vertices drawn, 6 per face record on the face path
+  int blockCount;
+} ChunkMesh;
+
+void meshBuilderReset(MeshBuilder* builder);
+void meshBuilderFree(MeshBuilder* builder);
+void meshBuilderAddQuad(MeshBuilder* builder, int face, enum BlockTexture texture, const Vec3i* origin, const Vec3i* size, unsigned ao);
+size_t meshBuilderByteSize(const MeshBuilder* builder);
+
+void chunkMeshesInit();
+void chunkMeshesCleanup();
+GpuArenaStats chunkMeshGetArenaStats();
+void chunkMeshUpload(ChunkMesh* mesh, const MeshBuilder* builder, const Vec3* origin);
+void chunkMeshQueueDraw(const ChunkMesh* mesh);
+int chunkMeshDrawQueued(RenderPath path);
+void chunkMeshDestroy(ChunkMesh* mesh);
+const char* getRenderPathText(RenderPath path);
+
+#endif // MESH_H
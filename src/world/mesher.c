@@ -0,0 +1,497 @@
+/**
+ * @file world/mesher.c
+ * @brief Builds chunk meshes from chunk blocks.
+ * @author frankischilling
+ * @date 2024-12-07
+ */
+#include "mesher.h"
+#include "world.h"
+#include <string.h>
+
+static inline enum BlockID snapshotGetBlock(const ChunkSnapshot* snapshot, int i, int j, int k) {
+  return (enum BlockID)snapshot->blocks[i][j][k];
+}
+
+// i and k may reach one block into the neighbor columns, everything above and below the chunk is air.
+static inline bool snapshotIsSolid(const ChunkSnapshot* snapshot, int i, int j, int k) {
+  return j >= 0 && j < CHUNK_HEIGHT && (snapshot->solid[i + 1][k + 1] >> j & 1);
+}
+
+// Exposed faces of every column, per face direction: bit y is set where the block at y is solid
+// and its neighbor across the face is air. Works on whole columns with shifts, borders come from
+// the neighbor columns in the snapshot and the outside of the world counts as air.
+static void computeFaceMasks(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE]) {
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      uint64_t column = snapshot->solid[i + 1][k + 1];
+      masks[RIGHT][i][k] = column & ~snapshot->solid[i + 2][k + 1];
+      masks[LEFT][i][k] = column & ~snapshot->solid[i][k + 1];
+      masks[TOP][i][k] = column & ~(column >> 1);
+      masks[BOTTOM][i][k] = column & ~(column << 1);
+      masks[FRONT][i][k] = column & ~snapshot->solid[i + 1][k + 2];
+      masks[REAR][i][k] = column & ~snapshot->solid[i + 1][k];
+    }
+  }
+}
+
+// Blocks in the section with at least one exposed face.
+static int countExposedBlocks(uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], int s) {
+  uint64_t sectionBits = (((uint64_t)1 << SECTION_HEIGHT) - 1) << (s * SECTION_HEIGHT);
+  int count = 0;
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      uint64_t exposed = 0;
+      for (int face = 0; face < 6; face++) {
+        exposed |= masks[face][i][k];
+      }
+      count += __builtin_popcountll(exposed & sectionBits);
+    }
+  }
+  return count;
+}
+
+// Ambient occlusion at the corners of one block face, packed as in QUAD_AO_OPEN. Each corner looks at the
+// two side blocks and the diagonal block in front of the face, two solid sides close the corner off.
+static unsigned computeFaceAO(const ChunkSnapshot* snapshot, int face, int i, int j, int k) {
+  int axis0 = face / 2 == 0 ? 1 : 0;
+  int axis1 = face / 2 == 2 ? 1 : 2;
+  const int front[3] = {i + vec3iFaceMap[face].x, j + vec3iFaceMap[face].y, k + vec3iFaceMap[face].z};
+  unsigned ao = 0;
+  for (int c = 0; c < 4; c++) {
+    int side0[3] = {front[0], front[1], front[2]};
+    int side1[3] = {front[0], front[1], front[2]};
+    side0[axis0] += c & 1 ? 1 : -1;
+    side1[axis1] += c & 2 ? 1 : -1;
+    bool solid0 = snapshotIsSolid(snapshot, side0[0], side0[1], side0[2]);
+    bool solid1 = snapshotIsSolid(snapshot, side1[0], side1[1], side1[2]);
+    side0[axis1] = side1[axis1];
+    bool solidCorner = snapshotIsSolid(snapshot, side0[0], side0[1], side0[2]);
+    unsigned value = solid0 && solid1 ? 0 : 3 - solid0 - solid1 - solidCorner;
+    ao |= value << (2 * c);
+  }
+  return ao;
+}
+
+// Emit every exposed face in heights with a darkened corner as a quad of its own and clear it from the masks,
+// the meshers then merge only fully lit faces so shading never stretches over a merged quad.
+static void meshShadedFaces(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], MeshBuilder* builder, uint64_t heights) {
+  const Vec3i unit = {1, 1, 1};
+
+  for (int face = 0; face < 6; face++) {
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+      for (int k = 0; k < CHUNK_SIZE; k++) {
+        uint64_t bits = masks[face][i][k] & heights;
+        while (bits) {
+          int j = __builtin_ctzll(bits);
+          bits &= bits - 1;
+          unsigned ao = computeFaceAO(snapshot, face, i, j, k);
+          if (ao == QUAD_AO_OPEN) {
+            continue;
+          }
+          meshBuilderAddQuad(builder, face, getBlockFaceTexture(snapshotGetBlock(snapshot, i, j, k), face), &(Vec3i){i, j, k}, &unit, ao);
+          masks[face][i][k] &= ~((uint64_t)1 << j);
+        }
+      }
+    }
+  }
+}
+
+// Check whether a section can be skipped without looking at its blocks.
+// Empty sections have nothing to draw, full sections enclosed by full sections have every face hidden.
+static bool isSectionSkipped(const Chunk* chunk, Chunk* const neighbors[4], int s) {
+  SectionState state = sectionGetState(&chunk->sections[s]);
+  if (state != SECTION_FULL) {
+    return state == SECTION_EMPTY;
+  }
+  // The top and bottom section face the outside of the world, which counts as air
+  if (s == 0 || s == CHUNK_SECTIONS - 1) {
+    return false;
+  }
+  if (sectionGetState(&chunk->sections[s - 1]) != SECTION_FULL || sectionGetState(&chunk->sections[s + 1]) != SECTION_FULL) {
+    return false;
+  }
+  for (int n = 0; n < 4; n++) {
+    if (!neighbors[n] || sectionGetState(&neighbors[n]->sections[s]) != SECTION_FULL) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Copy the blocks of a chunk and the border columns of its neighbors, diagonal ones included, must run on the main thread.
+void chunkSnapshotCreate(ChunkSnapshot* snapshot, const Chunk* chunk) {
+  memset(snapshot->blocks, BLOCK_AIR, sizeof(snapshot->blocks));
+  memset(snapshot->solid, 0, sizeof(snapshot->solid));
+
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    const ChunkSection* section = &chunk->sections[s];
+    if (sectionGetState(section) == SECTION_EMPTY) {
+      continue; // Already air
+    }
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+      for (int j = 0; j < SECTION_HEIGHT; j++) {
+        for (int k = 0; k < CHUNK_SIZE; k++) {
+          snapshot->blocks[i][s * SECTION_HEIGHT + j][k] = sectionGetBlock(section, i, j, k);
+        }
+      }
+    }
+  }
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      snapshot->solid[i + 1][k + 1] = chunk->solidColumns[i][k];
+    }
+  }
+
+  // Border columns from the four horizontal neighbors, in the order of the faces they touch
+  Chunk* neighbors[4];
+  int n = 0;
+  for (int face = 0; face < 6; face++) {
+    int dx = vec3iFaceMap[face].x;
+    int dz = vec3iFaceMap[face].z;
+    if (dx == 0 && dz == 0) {
+      continue;
+    }
+    Vec2i neighborPos = {chunk->position.a + dx, chunk->position.b + dz};
+    Chunk* neighbor = getChunk(&neighborPos);
+    neighbors[n++] = neighbor;
+    if (!neighbor) {
+      continue;
+    }
+
+    for (int t = 0; t < CHUNK_SIZE; t++) {
+      // Local position of the border column in the neighbor, and where it goes in the snapshot
+      int ni = dx > 0 ? 0 : dx < 0 ? CHUNK_SIZE - 1 : t;
+      int nk = dz > 0 ? 0 : dz < 0 ? CHUNK_SIZE - 1 : t;
+      int si = dx > 0 ? CHUNK_SIZE + 1 : dx < 0 ? 0 : t + 1;
+      int sk = dz > 0 ? CHUNK_SIZE + 1 : dz < 0 ? 0 : t + 1;
+      snapshot->solid[si][sk] = neighbor->solidColumns[ni][nk];
+    }
+  }
+
+  // Corner columns of the four diagonal neighbors, ambient occlusion at the corner columns reads them
+  for (int dx = -1; dx <= 1; dx += 2) {
+    for (int dz = -1; dz <= 1; dz += 2) {
+      Vec2i diagonalPos = {chunk->position.a + dx, chunk->position.b + dz};
+      Chunk* diagonal = getChunk(&diagonalPos);
+      if (diagonal) {
+        snapshot->solid[dx > 0 ? CHUNK_SIZE + 1 : 0][dz > 0 ? CHUNK_SIZE + 1 : 0] = diagonal->solidColumns[dx > 0 ? 0 : CHUNK_SIZE - 1][dz > 0 ? 0 : CHUNK_SIZE - 1];
+      }
+    }
+  }
+
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    snapshot->sectionSkipped[s] = isSectionSkipped(chunk, neighbors, s);
+  }
+}
+
+// Emit one face per block side that touches air.
+static void meshChunkNaive(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], MeshBuilder* builder, int s) {
+  const Vec3i unit = {1, 1, 1};
+
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int j = s * SECTION_HEIGHT; j < (s + 1) * SECTION_HEIGHT; j++) {
+      for (int k = 0; k < CHUNK_SIZE; k++) {
+        for (int face = 0; face < 6; face++) {
+          if (!(masks[face][i][k] >> j & 1)) {
+            continue;
+          }
+          Vec3i origin = {i, j, k};
+          meshBuilderAddQuad(builder, face, getBlockFaceTexture(snapshotGetBlock(snapshot, i, j, k), face), &origin, &unit, QUAD_AO_OPEN);
+        }
+      }
+    }
+  }
+}
+
+// Sweep every slice of a section along each face normal, collect the exposed faces of the slice
+// into a 2D mask keyed by texture and merge equal neighbors into the widest, then tallest, rectangles.
+static void meshChunkGreedy(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], MeshBuilder* builder, int s) {
+  static const int dims[3] = {CHUNK_SIZE, SECTION_HEIGHT, CHUNK_SIZE};
+  int mask[SECTION_HEIGHT * CHUNK_SIZE]; // texture + 1 of each exposed face, 0 for none
+  const int yBase = s * SECTION_HEIGHT;
+
+  for (int face = 0; face < 6; face++) {
+    int n = face / 2;         // Normal axis, faces come in (positive, negative) pairs of x, y, z
+    int u = n == 0 ? 2 : 0;   // Mask columns
+    int v = n == 1 ? 2 : 1;   // Mask rows
+    int width = dims[u];
+    int height = dims[v];
+
+    for (int slice = 0; slice < dims[n]; slice++) {
+      // Build the mask of exposed faces in this slice
+      for (int b = 0; b < height; b++) {
+        for (int a = 0; a < width; a++) {
+          int p[3];
+          p[n] = slice;
+          p[u] = a;
+          p[v] = b;
+          int* cell = &mask[b * width + a];
+          *cell = 0;
+
+          if (!(masks[face][p[0]][p[2]] >> (p[1] + yBase) & 1)) {
+            continue;
+          }
+          *cell = getBlockFaceTexture(snapshotGetBlock(snapshot, p[0], p[1] + yBase, p[2]), face) + 1;
+        }
+      }
+
+      // Merge the mask into quads
+      for (int b = 0; b < height; b++) {
+        for (int a = 0; a < width;) {
+          int texture = mask[b * width + a];
+          if (texture == 0) {
+            a++;
+            continue;
+          }
+
+          int w = 1;
+          while (a + w < width && mask[b * width + a + w] == texture) {
+            w++;
+          }
+
+          int h = 1;
+          for (; b + h < height; h++) {
+            bool rowMatches = true;
+            for (int c = 0; c < w; c++) {
+              if (mask[(b + h) * width + a + c] != texture) {
+                rowMatches = false;
+                break;
+              }
+            }
+            if (!rowMatches) {
+              break;
+            }
+          }
+
+          int origin[3], size[3];
+          origin[n] = slice;
+          origin[u] = a;
+          origin[v] = b;
+          size[n] = 1;
+          size[u] = w;
+          size[v] = h;
+          meshBuilderAddQuad(builder, face, texture - 1, &(Vec3i){origin[0], origin[1] + yBase, origin[2]}, &(Vec3i){size[0], size[1], size[2]}, QUAD_AO_OPEN);
+
+          // Clear the merged area so it is not emitted again
+          for (int r = 0; r < h; r++) {
+            for (int c = 0; c < w; c++) {
+              mask[(b + r) * width + a + c] = 0;
+            }
+          }
+          a += w;
+        }
+      }
+    }
+  }
+}
+
+// Merge the rows of one plane into rectangles: each run of set bits in a row becomes a quad that grows
+// over the following rows for as long as they contain the whole run. Clears every bit it emits.
+static void mergePlaneRows(MeshBuilder* builder, int face, enum BlockTexture texture, uint64_t* rows, int rowCount, const int axes[3], int slice) {
+  for (int r = 0; r < rowCount; r++) {
+    while (rows[r]) {
+      int start = __builtin_ctzll(rows[r]);
+      uint64_t shifted = ~(rows[r] >> start);
+      int length = shifted ? __builtin_ctzll(shifted) : 64 - start;
+      uint64_t run = (length == 64 ? ~(uint64_t)0 : ((uint64_t)1 << length) - 1) << start;
+
+      int span = 1;
+      while (r + span < rowCount && (rows[r + span] & run) == run) {
+        rows[r + span] &= ~run;
+        span++;
+      }
+      rows[r] &= ~run;
+
+      // axes holds the slice, row and bit axis of the plane
+      int origin[3], size[3];
+      origin[axes[0]] = slice;
+      origin[axes[1]] = r;
+      origin[axes[2]] = start;
+      size[axes[0]] = 1;
+      size[axes[1]] = span;
+      size[axes[2]] = length;
+      meshBuilderAddQuad(builder, face, texture, &(Vec3i){origin[0], origin[1], origin[2]}, &(Vec3i){size[0], size[1], size[2]}, QUAD_AO_OPEN);
+    }
+  }
+}
+
+// Greedy meshing on solid masks of the blocks whose y bit is set in heights, one section at a time.
+// Faces are split per block id, then every plane is merged with mergePlaneRows: side faces use the y columns
+// directly as rows, top and bottom faces are first transposed into rows along z.
+static void meshChunkBinary(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], MeshBuilder* builder, uint64_t heights) {
+  // Exposed blocks of each id per column, only blocks with a visible face are looked up
+  uint64_t idMasks[BLOCK_ID_COUNT][CHUNK_SIZE][CHUNK_SIZE];
+  memset(idMasks, 0, sizeof(idMasks));
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      uint64_t exposed = 0;
+      for (int face = 0; face < 6; face++) {
+        exposed |= masks[face][i][k];
+      }
+      exposed &= heights;
+      while (exposed) {
+        int j = __builtin_ctzll(exposed);
+        idMasks[snapshotGetBlock(snapshot, i, j, k)][i][k] |= (uint64_t)1 << j;
+        exposed &= exposed - 1;
+      }
+    }
+  }
+
+  for (int face = 0; face < 6; face++) {
+    for (int id = BLOCK_AIR + 1; id < BLOCK_ID_COUNT; id++) {
+      enum BlockTexture texture = getBlockFaceTexture(id, face);
+
+      if (face == TOP || face == BOTTOM) {
+        // Transpose into one plane per y, rows along x holding bits along z
+        uint64_t planes[CHUNK_HEIGHT][CHUNK_SIZE];
+        uint64_t usedPlanes = 0;
+        memset(planes, 0, sizeof(planes));
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+          for (int k = 0; k < CHUNK_SIZE; k++) {
+            uint64_t bits = masks[face][i][k] & idMasks[id][i][k];
+            usedPlanes |= bits;
+            while (bits) {
+              int j = __builtin_ctzll(bits);
+              planes[j][i] |= (uint64_t)1 << k;
+              bits &= bits - 1;
+            }
+          }
+        }
+        static const int axes[3] = {1, 0, 2};
+        while (usedPlanes) {
+          int j = __builtin_ctzll(usedPlanes);
+          mergePlaneRows(builder, face, texture, planes[j], CHUNK_SIZE, axes, j);
+          usedPlanes &= usedPlanes - 1;
+        }
+      } else {
+        // Planes across the normal axis, rows along the other horizontal axis holding bits along y
+        bool alongX = face == RIGHT || face == LEFT;
+        const int axes[3] = {alongX ? 0 : 2, alongX ? 2 : 0, 1};
+        for (int slice = 0; slice < CHUNK_SIZE; slice++) {
+          uint64_t rows[CHUNK_SIZE];
+          uint64_t used = 0;
+          for (int r = 0; r < CHUNK_SIZE; r++) {
+            int i = alongX ? slice : r;
+            int k = alongX ? r : slice;
+            rows[r] = masks[face][i][k] & idMasks[id][i][k];
+            used |= rows[r];
+          }
+          if (used) {
+            mergePlaneRows(builder, face, texture, rows, CHUNK_SIZE, axes, slice);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Shaded faces of the section are taken out of the masks, the bits of other sections are left alone.
+static void meshSection(const ChunkSnapshot* snapshot, uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE], MeshBuilder* builder, int s, MeshMode mode) {
+  if (snapshot->sectionSkipped[s]) {
+    return;
+  }
+  builder->blockCount += countExposedBlocks(masks, s);
+  meshShadedFaces(snapshot, masks, builder, (((uint64_t)1 << SECTION_HEIGHT) - 1) << (s * SECTION_HEIGHT));
+  switch (mode) {
+  case MESH_BINARY:
+    meshChunkBinary(snapshot, masks, builder, (((uint64_t)1 << SECTION_HEIGHT) - 1) << (s * SECTION_HEIGHT));
+    break;
+  case MESH_GREEDY:
+    meshChunkGreedy(snapshot, masks, builder, s);
+    break;
+  case MESH_NAIVE:
+  default:
+    meshChunkNaive(snapshot, masks, builder, s);
+    break;
+  }
+}
+
+// Build the meshes of the sections whose bit is set in sections, each into its own builder.
+// Quads never cross a section boundary, so a section can be rebuilt without touching the others.
+// Safe to call from any thread.
+void meshChunkSections(const ChunkSnapshot* snapshot, MeshBuilder builders[CHUNK_SECTIONS], unsigned sections, MeshMode mode) {
+  uint64_t masks[6][CHUNK_SIZE][CHUNK_SIZE];
+  computeFaceMasks(snapshot, masks);
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    if (sections >> s & 1) {
+      meshBuilderReset(&builders[s]);
+      meshSection(snapshot, masks, &builders[s], s, mode);
+    }
+  }
+}
+
+// Which faces of a section see each other through air. Every air region of the section is flood filled
+// and all the faces it touches are connected. Solid and empty sections are answered from the solid masks.
+SectionConnectivity computeSectionConnectivity(const ChunkSnapshot* snapshot, int s) {
+  uint64_t sectionBits = (((uint64_t)1 << SECTION_HEIGHT) - 1) << (s * SECTION_HEIGHT);
+  int solidCount = 0;
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      solidCount += __builtin_popcountll(snapshot->solid[i + 1][k + 1] & sectionBits);
+    }
+  }
+  if (solidCount == 0) {
+    return SECTION_ALL_CONNECTED;
+  }
+  if (solidCount == SECTION_VOLUME) {
+    return 0;
+  }
+
+  bool visited[SECTION_VOLUME] = {false};
+  uint16_t stack[SECTION_VOLUME];
+  SectionConnectivity connectivity = 0;
+  for (int start = 0; start < SECTION_VOLUME; start++) {
+    int i = start / (SECTION_HEIGHT * SECTION_SIZE);
+    int j = start / SECTION_SIZE % SECTION_HEIGHT;
+    int k = start % SECTION_SIZE;
+    if (visited[start] || snapshot->solid[i + 1][k + 1] >> (s * SECTION_HEIGHT + j) & 1) {
+      continue;
+    }
+
+    unsigned faces = 0;
+    int top = 0;
+    visited[start] = true;
+    stack[top++] = start;
+    while (top > 0) {
+      int index = stack[--top];
+      int x = index / (SECTION_HEIGHT * SECTION_SIZE);
+      int y = index / SECTION_SIZE % SECTION_HEIGHT;
+      int z = index % SECTION_SIZE;
+      for (int face = 0; face < 6; face++) {
+        int nx = x + vec3iFaceMap[face].x;
+        int ny = y + vec3iFaceMap[face].y;
+        int nz = z + vec3iFaceMap[face].z;
+        if (nx < 0 || nx >= CHUNK_SIZE || ny < 0 || ny >= SECTION_HEIGHT || nz < 0 || nz >= CHUNK_SIZE) {
+          faces |= 1u << face; // The region reaches this side of the section
+          continue;
+        }
+        int next = sectionIndex(nx, ny, nz);
+        if (!visited[next] && !(snapshot->solid[nx + 1][nz + 1] >> (s * SECTION_HEIGHT + ny) & 1)) {
+          visited[next] = true;
+          stack[top++] = next;
+        }
+      }
+    }
+
+    for (int a = 0; a < 6; a++) {
+      for (int b = 0; b < 6; b++) {
+        if ((faces >> a & 1) && (faces >> b & 1)) {
+          connectivity |= (SectionConnectivity)1 << (a * 6 + b);
+        }
+      }
+    }
+  }
+  return connectivity;
+}
+
+const char* getMeshModeText(MeshMode mode) {
+  switch (mode) {
+  case MESH_GREEDY:
+    return "Greedy";
+  case MESH_BINARY:
+    return "Binary";
+  case MESH_NAIVE:
+  default:
+    return "Naive";
+  }
+}
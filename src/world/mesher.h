@@ -0,0 +1,34 @@
+/**
+ * @file world/mesher.h
+ * @brief Builds chunk meshes from chunk blocks.
+ * @author frankischilling
+ * @date 2024-12-07
+ */
+#ifndef MESHER_H
+#define MESHER_H
+
+#include "chunk.h"
+#include "mesh.h"
+
+typedef enum {
+  MESH_NAIVE,  // One quad per exposed block face
+  MESH_GREEDY, // Coplanar faces with the same texture merged into larger quads
+  MESH_BINARY, // Greedy merging done on whole columns of solid masks with bit operations
+  MESH_MODE_COUNT,
+} MeshMode;
+
+// Copy of everything meshing a chunk reads: its blocks plus the solid masks of a one column border
+// taken from the neighboring chunks (air where there is none). Lets meshing run on a worker thread
+// while the chunk keeps changing on the main thread.
+typedef struct {
+  uint8_t blocks[CHUNK_SIZE][CHUNK_HEIGHT][CHUNK_SIZE]; // block ids of the chunk
+  uint64_t solid[CHUNK_SIZE + 2][CHUNK_SIZE + 2];       // solid column masks at [x + 1][z + 1], see Chunk.solidColumns
+  bool sectionSkipped[CHUNK_SECTIONS];                  // section has no visible faces
+} ChunkSnapshot;
+
+void chunkSnapshotCreate(ChunkSnapshot* snapshot, const Chunk* chunk);
+void meshChunkSections(const ChunkSnapshot* snapshot, MeshBuilder builders[CHUNK_SECTIONS], unsigned sections, MeshMode mode);
+SectionConnectivity computeSectionConnectivity(const ChunkSnapshot* snapshot, int s);
+const char* getMeshModeText(MeshMode mode);
+
+#endif // MESHER_H
@@ -0,0 +1,89 @@
+/**
+ * @file world/section.c
+ * @brief Palette compressed block storage for one 16 block high slice of a chunk.
+ * @author frankischilling
+ * @date 2024-12-08
+ */
+#include "section.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static size_t sectionWordCount(int bits) {
+  return (size_t)SECTION_VOLUME * bits / 64;
+}
+
+static unsigned readIndex(const uint64_t* data, int bits, int index) {
+  unsigned bit = (unsigned)index * bits;
+  return (unsigned)(data[bit >> 6] >> (bit & 63)) & ((1u << bits) - 1);
+}
+
+static void writeIndex(uint64_t* data, int bits, int index, unsigned value) {
+  unsigned bit = (unsigned)index * bits;
+  uint64_t mask = (uint64_t)((1u << bits) - 1) << (bit & 63);
+  data[bit >> 6] = (data[bit >> 6] & ~mask) | ((uint64_t)value << (bit & 63));
+}
+
+// Re-pack every index with a wider bit width so the palette can hold more block ids.
+static bool sectionGrow(ChunkSection* section) {
+  int bits = section->bits == 0 ? 1 : section->bits * 2;
+  uint64_t* data = (uint64_t*)calloc(sectionWordCount(bits), sizeof(uint64_t));
+  if (!data) {
+    fprintf(stderr, "Failed to grow chunk section to %d bits per block\n", bits);
+    return false;
+  }
+
+  // A single value section is all index 0, which calloc already wrote
+  if (section->bits != 0) {
+    for (int i = 0; i < SECTION_VOLUME; i++) {
+      writeIndex(data, bits, i, readIndex(section->data, section->bits, i));
+    }
+  }
+
+  free(section->data);
+  section->data = data;
+  section->bits = bits;
+  return true;
+}
+
+void sectionInit(ChunkSection* section, enum BlockID fill) {
+  section->data = NULL;
+  section->bits = 0;
+  section->paletteSize = 1;
+  section->palette[0] = fill;
+  section->solidCount = fill == BLOCK_AIR ? 0 : SECTION_VOLUME;
+}
+
+void sectionFree(ChunkSection* section) {
+  free(section->data);
+  section->data = NULL;
+  section->bits = 0;
+}
+
+void sectionSetBlock(ChunkSection* section, int x, int y, int z, enum BlockID id) {
+  enum BlockID previous = section->bits == 0 ? section->palette[0] : section->palette[readIndex(section->data, section->bits, sectionIndex(x, y, z))];
+  if (previous == id) {
+    return;
+  }
+
+  int paletteIndex = 0;
+  while (paletteIndex < section->paletteSize && section->palette[paletteIndex] != id) {
+    paletteIndex++;
+  }
+
+  if (paletteIndex == section->paletteSize) {
+    // New block id for this section, widen the indices when the palette is full.
+    // Entries are never removed, a section that had 3 ids keeps 2 bit indices.
+    if (section->paletteSize == (1 << section->bits) && !sectionGrow(section)) {
+      return;
+    }
+    section->palette[section->paletteSize++] = id;
+  }
+
+  writeIndex(section->data, section->bits, sectionIndex(x, y, z), paletteIndex);
+  section->solidCount += (id != BLOCK_AIR) - (previous != BLOCK_AIR);
+}
+
+// Bytes used by the section, including its packed indices.
+size_t sectionMemoryUsage(const ChunkSection* section) {
+  return sizeof(ChunkSection) + sectionWordCount(section->bits) * sizeof(uint64_t);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file world/section.h
+ * @brief Palette compressed block storage for one 16 block high slice of a chunk.
+ * @author frankischilling
+ * @date 2024-12-08
+ */
+#ifndef SECTION_H
+#define SECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cube.h"
+
+#define SECTION_SIZE 16   // block count along x and z
+#define SECTION_HEIGHT 16 // block count along y
+#define SECTION_VOLUME (SECTION_SIZE * SECTION_HEIGHT * SECTION_SIZE)
+#define SECTION_PALETTE_MAX 16 // largest palette, indexed with 4 bits
+
+_Static_assert(BLOCK_ID_COUNT <= SECTION_PALETTE_MAX, "block ids no longer fit in a section palette");
+
+typedef enum {
+  SECTION_EMPTY, // Only air
+  SECTION_FULL,  // No air at all
+  SECTION_MIXED,
+} SectionState;
+
+// Blocks are stored as indices into a small palette of block ids, packed into 64 bit words.
+// Index widths are powers of two so an index never straddles two words.
+// A section holding a single block id stores no indices at all.
+typedef struct {
+  uint64_t* data;                       // SECTION_VOLUME indices of `bits` bits each, NULL when bits is 0
+  uint16_t solidCount;                  // non air blocks, decides the section state
+  uint8_t bits;                         // 0, 1, 2 or 4
+  uint8_t paletteSize;                  // used palette entries
+  uint8_t palette[SECTION_PALETTE_MAX]; // block id of each index
+} ChunkSection;
+
+void sectionInit(ChunkSection* section, enum BlockID fill);
+void sectionFree(ChunkSection* section);
+void sectionSetBlock(ChunkSection* section, int x, int y, int z, enum BlockID id);
+size_t sectionMemoryUsage(const ChunkSection* section);
+
+// Position of a block inside the section, same x, y, z nesting as a [x][y][z] array
+static inline int sectionIndex(int x, int y, int z) {
+  return (x * SECTION_HEIGHT + y) * SECTION_SIZE + z;
+}
+
+static inline SectionState sectionGetState(const ChunkSection* section) {
+  if (section->solidCount == 0) {
+    return SECTION_EMPTY;
+  }
+  return section->solidCount == SECTION_VOLUME ? SECTION_FULL : SECTION_MIXED;
+}
+
+static inline enum BlockID sectionGetBlock(const ChunkSection* section, int x, int y, int z) {
+  if (section->solidCount == 0) {
+    return BLOCK_AIR; // Empty sections never touch their indices
+  }
+  if (section->bits == 0) {
+    return (enum BlockID)section->palette[0];
+  }
+  unsigned bit = (unsigned)sectionIndex(x, y, z) * section->bits;
+  unsigned index = (unsigned)(section->data[bit >> 6] >> (bit & 63)) & ((1u << section->bits) - 1);
+  return (enum BlockID)section->palette[index];
+}
+
+#endif // SECTION_H
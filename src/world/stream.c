@@ -0,0 +1,98 @@
+/**
+ * @file world/stream.c
+ * @brief Loads chunks around the camera and unloads the ones left behind.
+ * @author frankischilling
+ * @date 2024-12-10
+ */
+#include "stream.h"
+#include <math.h>
+#include <stdlib.h>
+#include "world.h"
+
+#define LOAD_DIAMETER (2 * CHUNK_LOAD_RADIUS + 1)
+
+typedef struct {
+  Vec2i position;
+  bool visible;  // inside the view frustum
+  int distance2; // squared distance in chunks to the camera chunk
+} ChunkRequest;
+
+static ChunkRequest requests[LOAD_DIAMETER * LOAD_DIAMETER];
+
+// Chunks in view come first, then the nearest ones.
+static int compareRequests(const void* a, const void* b) {
+  const ChunkRequest* ra = (const ChunkRequest*)a;
+  const ChunkRequest* rb = (const ChunkRequest*)b;
+  if (ra->visible != rb->visible) {
+    return ra->visible ? -1 : 1;
+  }
+  return ra->distance2 - rb->distance2;
+}
+
+static int chunkDistance2(const Vec2i* a, const Vec2i* b) {
+  int dx = a->a - b->a;
+  int dz = a->b - b->b;
+  return dx * dx + dz * dz;
+}
+
+// Unload chunks past the unload radius and generate the most important missing chunks inside the load radius.
+StreamStats streamChunks(const Camera* camera, const Frustum* frustum) {
+  StreamStats stats = {0, 0, 0};
+  Vec3i cameraBlock = {(int)floorf(camera->position.x), 0, (int)floorf(camera->position.z)};
+  Vec2i center = blockToChunk(&cameraBlock);
+
+  // Collect first, removing from the map while iterating it would skip entries
+  Chunk* farChunks[CHUNK_UNLOADS_PER_FRAME];
+  int farCount = 0;
+  int generating = 0;
+  int iterator = 0;
+  Chunk* chunk;
+  while ((chunk = getNextChunk(&iterator))) {
+    if (chunk->state == CHUNK_GENERATING) {
+      generating++;
+    }
+    if (farCount < CHUNK_UNLOADS_PER_FRAME && chunkDistance2(&chunk->position, &center) > CHUNK_UNLOAD_RADIUS * CHUNK_UNLOAD_RADIUS) {
+      farChunks[farCount++] = chunk;
+    }
+  }
+  for (int i = 0; i < farCount; i++) {
+    if (farChunks[i]->state == CHUNK_GENERATING) {
+      generating--;
+    }
+    unloadChunk(farChunks[i]);
+  }
+
+  int requestCount = 0;
+  for (int dx = -CHUNK_LOAD_RADIUS; dx <= CHUNK_LOAD_RADIUS; dx++) {
+    for (int dz = -CHUNK_LOAD_RADIUS; dz <= CHUNK_LOAD_RADIUS; dz++) {
+      int distance2 = dx * dx + dz * dz;
+      Vec2i chunkPos = {center.a + dx, center.b + dz};
+      if (distance2 > CHUNK_LOAD_RADIUS * CHUNK_LOAD_RADIUS || hasChunk(&chunkPos)) {
+        continue;
+      }
+
+      Vec3 chunkCenter = getChunkCenter(&chunkPos);
+      Vec3 chunkDimensions = CHUNK_DIMENSIONS;
+      requests[requestCount++] = (ChunkRequest){chunkPos, frustum_block_visible(frustum, &chunkCenter, &chunkDimensions, camera), distance2};
+    }
+  }
+
+  // Workers pick up chunks in submission order, so the most important ones are generated first
+  qsort(requests, requestCount, sizeof(ChunkRequest), compareRequests);
+  int loads = CHUNK_MAX_GENERATING - generating;
+  loads = requestCount < loads ? requestCount : loads;
+  for (int i = 0; i < loads; i++) {
+    loadChunk(&requests[i].position);
+  }
+
+  iterator = 0;
+  while ((chunk = getNextChunk(&iterator))) {
+    // Blocks of generating chunks belong to the workers
+    if (chunk->state == CHUNK_READY) {
+      stats.loadedChunks++;
+      stats.chunkMemory += chunkMemoryUsage(chunk);
+    }
+  }
+  stats.queuedChunks = generating + requestCount;
+  return stats;
+}
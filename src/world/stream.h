@@ -0,0 +1,30 @@
+/**
+ * @file world/stream.h
+ * @brief Loads chunks around the camera and unloads the ones left behind.
+ * @author frankischilling
+ * @date 2024-12-10
+ */
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include "../graphics/camera.h"
+#include "../graphics/frustum.h"
+
+// Radii in chunks around the chunk holding the camera. Chunks are loaded inside the load radius and only
+// unloaded once they are past the larger unload radius, so walking along a boundary does not thrash.
+// The load radius has to reach one chunk past the render distance so drawn chunks have all their neighbors.
+#define CHUNK_LOAD_RADIUS 4
+#define CHUNK_UNLOAD_RADIUS 6
+#define CHUNK_MAX_GENERATING 64    // chunks handed to the workers at once, the rest waits so priorities stay fresh
+#define CHUNK_UNLOADS_PER_FRAME 32 // chunks freed per frame at most
+
+typedef struct {
+  int loadedChunks; // chunks currently in memory
+  int queuedChunks; // chunks inside the load radius being generated or waiting to be
+  size_t chunkMemory; // bytes used by the loaded chunks
+} StreamStats;
+
+StreamStats streamChunks(const Camera* camera, const Frustum* frustum);
+
+#endif // STREAM_H
@@ -8,66 +8,479 @@
  */
 #include <GL/glew.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "world.h"
 #include "../graphics/camera.h"
 #include "../graphics/frustum.h"
+#include "../graphics/occluder.h"
 #include "../graphics/shader.h"
 #include "../graphics/texture.h"
 #include "../math/math.h"
+#include "../math/noise.h"
 #include "cube.h"
 #include "chunk.h"
-static GLuint stoneTexture, dirtTexture, grassTopTexture, grassSideTexture;
+#include "mesh.h"
+#include "mesher.h"
+#include "chunkmap.h"
+#include "../utils/threadpool.h"
+#define TERRAIN_SAMPLES_MAX ((CHUNK_SIZE + 1) * (CHUNK_SIZE + 1)) // Largest terrain lattice, spacing 1 plus the next chunk border
+
+static GLuint blockTextures; // Texture array with one layer per enum BlockTexture
+static ShaderProgram chunkShaders[RENDER_PATH_COUNT]; // Draws chunk meshes of each render path
+
+#define RENDER_DISTANCE 4.0f          // Diameter in chunks around the camera that is drawn
+#define MESH_MAX_JOBS 32              // Mesh builds queued on the workers at once
+#define MESH_UPLOAD_BUDGET (1 << 20)  // Vertex bytes uploaded per frame, at least one mesh always goes through
+#define OCCLUDER_DISTANCE (CHUNK_SIZE * 2.0f) // Chunks with their center this close to the camera draw into the software depth buffer
+#define OCCLUDER_COLUMNS 4            // Columns along each side of one software occluder box
+
+static MeshMode meshMode = MESH_BINARY;
+static RenderPath renderPath = RENDER_VERTICES;
+
+// Mesh build timings since the mesh mode was last changed
+static double meshBuildSeconds = 0.0;
+static int meshBuildCount = 0;
+
+// Loaded chunks keyed by chunk coordinates, the world has no fixed bounds
+static ChunkMap chunks;
+
+// Generates chunk blocks and builds chunk meshes off the main thread
+static ThreadPool workers;
+
+// Loaded chunks by distance to the camera, nearest first, so chunks are drawn front to back and
+// hidden fragments fail the depth test before lighting. Re-sorted every frame with insertion sort,
+// which is close to a single pass because the order barely changes between frames.
+typedef struct {
+  Chunk* chunk;
+  float distance2; // Squared distance from the camera to the chunk center
+} DrawOrderEntry;
+
+static DrawOrderEntry* drawOrder = NULL;
+static int drawOrderCount = 0;
+static int drawOrderCapacity = 0;
+static bool chunkSorting = true;
+
+// Fragments that passed the depth test while drawing chunks, read two frames later so the query never stalls
+static GLuint overdrawQueries[2];
+static GLint overdrawPixels[2]; // Viewport size of the frame each query was issued in, 0 when never issued
+static int overdrawFrame = 0;
+static float overdraw = 0.0f;
+
+// Sections reached by the visibility walk, see walkVisibleSections
+typedef struct {
+  Chunk* chunk;
+  int section;
+  int entryFace;       // Face the walk came in through, -1 for the camera section
+  unsigned directions; // Bit per face direction the walk has moved in so far
+} SectionVisit;
+
+static SectionVisit* visitQueue = NULL;
+static int visitQueueCapacity = 0;
+static unsigned visitFrame = 0;
+static bool caveCulling = true;
+
+// Chunk occlusion queries: after the chunks are drawn, the bounding boxes of the chunks that reached drawing are
+// drawn against the finished depth buffer, and a chunk whose box had no visible sample is skipped the next frame
+typedef enum {
+  OCCLUSION_VISIBLE,
+  OCCLUSION_HIDDEN,
+  OCCLUSION_PENDING, // Last query still in flight, draw under conditional rendering
+} OcclusionState;
+
+typedef struct {
+  Chunk* chunk;
+  unsigned sections; // Sections to draw, bit s for section s
+} ChunkDraw;
+
+static bool occlusionCulling = false;
+static bool conditionalRender = false;
+static GLenum occlusionTarget = GL_ANY_SAMPLES_PASSED;
+static ShaderProgram boundsShader;
+static GLuint boundsVAO = 0;
+static GLuint boundsVBO = 0;
+static Chunk** occlusionTests = NULL;  // Chunks to query once this frame is drawn
+static int occlusionTestCount = 0;
+static ChunkDraw* pendingDraws = NULL; // Chunks whose query result has not reached the CPU yet
+static int pendingDrawCount = 0;
+static int occlusionCapacity = 0; // Capacity of both lists
+static unsigned renderFrame = 0;
+
+// Depth of the solid ground around the camera, rasterized on the CPU to cull sections before anything reaches the GPU
+static OccluderBuffer occluderBuffer;
+static bool softwareCulling = false;
+
+// Columns between exact terrain samples, read by the generation workers
+static atomic_int terrainSampleSpacing = 1;
+
+// A mesh build of the dirty sections of one chunk, from snapshot on the main thread through meshing on a worker
+// to upload on the main thread
+typedef struct MeshJob {
+  Chunk* chunk;
+  unsigned version;  // Chunk version the snapshot was taken at
+  unsigned sections; // Sections rebuilt by the job, bit s for section s
+  MeshMode mode;
+  RenderPath path;
+  ChunkSnapshot snapshot;
+  MeshBuilder builders[CHUNK_SECTIONS];
+  SectionConnectivity connectivity[CHUNK_SECTIONS];
+  double buildSeconds;
+  struct MeshJob* next;
+} MeshJob;
+
+// Built meshes waiting for their upload, oldest first
+static MeshJob* uploadHead = NULL;
+static MeshJob* uploadTail = NULL;
+static int meshJobCount = 0; // Mesh jobs on the workers or in the upload queue
+
+// Fill the blocks of a chunk from the terrain height at its position.
+// Only depends on the chunk position, so any thread generates the same blocks.
+static void generateChunkBlocks(Chunk* chunk) {
+  float heights[CHUNK_SIZE][CHUNK_SIZE];
+  getTerrainHeightGridSampled(&chunk->position, getTerrainSampleSpacing(), heights);
+
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      int height = (int)floor(heights[i][k]);
+      // Sections start out as air, so only the column up to the surface is written
+      for (int j = 0; j < CHUNK_HEIGHT && j <= height; j++) {
+        if (j < height - DIRT_LAYERS) {
+          chunkSetBlock(chunk, i, j, k, BLOCK_STONE);
+        } else if (j < height) {
+          chunkSetBlock(chunk, i, j, k, BLOCK_DIRT);
+        } else {
+          chunkSetBlock(chunk, i, j, k, BLOCK_GRASS);
+        }
+      }
+    }
+  }
+}
 
-// 2d array of chunk pointers
-Chunk*** chunks = NULL;
-//                    index I      J coord X      Z
-// FIRST  QUADRANT chunks[8 ,15][8 ,15] [0 , 7][0 , 7]
-// SECOND QUADRANT chunks[8 ,15][0 , 7] [0 , 7][-8,-1]
-// THIRD  QUADRANT chunks[0 , 7][0 , 7] [-8,-1][-8,-1]
-// FOURTH QUADRANT chunks[0 , 7][8 ,15] [-8,-1][0 , 7]
+static Chunk* createChunk(const Vec2i* chunkPos) {
+  Chunk* chunk = (Chunk*)malloc(sizeof(Chunk)); // allocate memory for single chunk
+  if (!chunk) {
+    fprintf(stderr, "Failed to allocate chunk %d,%d\n", chunkPos->a, chunkPos->b);
+    return NULL;
+  }
 
-static GLuint VBO, VAO;
+  chunk->position = *chunkPos;
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    chunk->meshes[s] = (ChunkMesh){0};
+    chunk->connectivity[s] = SECTION_ALL_CONNECTED;
+    chunk->visitFrame[s] = 0;
+  }
+  chunk->occlusionQuery = 0;
+  chunk->occlusionPending = false;
+  chunk->occluded = false;
+  chunk->occlusionFrame = 0;
+  chunk->dirtySections = CHUNK_ALL_SECTIONS;
+  chunk->version = 0;
+  chunk->meshJobs = 0;
+  chunk->state = CHUNK_GENERATING;
+  chunk->unloaded = false;
+  chunkInitBlocks(chunk);
+  return chunk;
+}
 
-// Chunk functions
-void initChunks() {
-  // Calculate how many chunks fit into the world
+static void destroyChunk(Chunk* chunk) {
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    chunkMeshDestroy(&chunk->meshes[s]);
+  }
+  if (chunk->occlusionQuery != 0) {
+    glDeleteQueries(1, &chunk->occlusionQuery);
+  }
+  chunkFreeBlocks(chunk);
+  free(chunk);
+}
 
-  // Allocate memory for chunks
-  chunks = (Chunk***)malloc(CHUNKS_PER_AXIS * sizeof(Chunk**)); // Allocate memory for the array of Chunk* pointers
-  for (int chunkI = 0; chunkI < CHUNKS_PER_AXIS; chunkI++) {
-    chunks[chunkI] = (Chunk**)malloc(CHUNKS_PER_AXIS * sizeof(Chunk*)); // Allocate memory for each row of Chunk* pointers
-    for (int chunkJ = 0; chunkJ < CHUNKS_PER_AXIS; chunkJ++) {
-      Chunk* chunk = (Chunk*)malloc(sizeof(Chunk)); // allocate memory for single chunk
+// Flag the meshes of some sections of a chunk for a rebuild, builds already under way are dropped when they finish.
+static void markSectionsDirty(Chunk* chunk, unsigned sections) {
+  chunk->dirtySections |= sections;
+  chunk->version++;
+}
 
-      chunk->position.a = (chunkI - CHUNKS_PER_AXIS / 2);
-      chunk->position.b = (chunkJ - CHUNKS_PER_AXIS / 2);
+static void markChunkDirty(Chunk* chunk) {
+  markSectionsDirty(chunk, CHUNK_ALL_SECTIONS);
+}
 
-      for (int i = 0; i < CHUNK_SIZE; i++) {
-        for (int k = 0; k < CHUNK_SIZE; k++) {
-          float worldX = chunk->position.a * 16 + i * CUBE_SIZE;
-          float worldZ = chunk->position.b * 16 + k * CUBE_SIZE;
-          int height = (int)floor(getTerrainHeight(worldX, worldZ));
-          for (int j = 0; j < CHUNK_HEIGHT; j++) {
-            if (j < height - DIRT_LAYERS) {
-              chunk->blocks[i][j][k] = (Block){BLOCK_STONE, false, {0, 0, 0, 0, 0, 0}};
-            } else if (j < height) {
-              chunk->blocks[i][j][k] = (Block){BLOCK_DIRT, false, {0, 0, 0, 0, 0, 0}};
-            } else if (j == (int)height) {
-              chunk->blocks[i][j][k] = (Block){BLOCK_GRASS, false, {0, 0, 0, 0, 0, 0}};
-            } else {
-              chunk->blocks[i][j][k] = (Block){BLOCK_AIR, false, {0, 0, 0, 0, 0, 0}};
-            }
-          }
+// Neighbors that exist mesh their shared border against this chunk, so they need a rebuild
+static void markNeighborsDirty(const Vec2i* chunkPos) {
+  for (int face = 0; face < 6; face++) {
+    if (vec3iFaceMap[face].y != 0) {
+      continue;
+    }
+    Vec2i neighborPos = {chunkPos->a + vec3iFaceMap[face].x, chunkPos->b + vec3iFaceMap[face].z};
+    Chunk* neighbor = getChunk(&neighborPos);
+    if (neighbor) {
+      markChunkDirty(neighbor);
+    }
+  }
+}
+
+static void generateChunkJob(void* data) {
+  generateChunkBlocks((Chunk*)data);
+}
+
+// Runs on the main thread once a worker generated the blocks of a chunk
+static void finishChunkJob(void* data) {
+  Chunk* chunk = (Chunk*)data;
+  if (chunk->unloaded) {
+    destroyChunk(chunk);
+    return;
+  }
+  chunk->state = CHUNK_READY;
+  markChunkDirty(chunk);
+  markNeighborsDirty(&chunk->position);
+}
+
+static void buildMeshJob(void* data) {
+  MeshJob* job = (MeshJob*)data;
+  double buildStart = glfwGetTime();
+  meshChunkSections(&job->snapshot, job->builders, job->sections, job->mode);
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    if (job->sections >> s & 1) {
+      job->connectivity[s] = computeSectionConnectivity(&job->snapshot, s);
+    }
+  }
+  job->buildSeconds = glfwGetTime() - buildStart;
+}
+
+// Runs on the main thread once a worker built a mesh, the upload waits for the next frame budget
+static void finishMeshJob(void* data) {
+  MeshJob* job = (MeshJob*)data;
+  job->next = NULL;
+  if (uploadTail) {
+    uploadTail->next = job;
+  } else {
+    uploadHead = job;
+  }
+  uploadTail = job;
+}
+
+// Let go of a mesh job, freeing its chunk if the chunk was unloaded and nothing else uses it.
+static void releaseMeshJob(MeshJob* job) {
+  Chunk* chunk = job->chunk;
+  chunk->meshJobs--;
+  if (chunk->unloaded && chunk->meshJobs == 0) {
+    destroyChunk(chunk);
+  }
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    meshBuilderFree(&job->builders[s]);
+  }
+  free(job);
+  meshJobCount--;
+}
+
+// Snapshot a chunk and queue its mesh build. The snapshot is taken now, so later block changes
+// only bump the chunk version and never race with the worker.
+static void submitMeshJob(Chunk* chunk) {
+  MeshJob* job = (MeshJob*)calloc(1, sizeof(MeshJob));
+  if (!job) {
+    fprintf(stderr, "Failed to allocate mesh job for chunk %d,%d\n", chunk->position.a, chunk->position.b);
+    return;
+  }
+  job->chunk = chunk;
+  job->version = chunk->version;
+  job->sections = chunk->dirtySections;
+  job->mode = meshMode;
+  job->path = renderPath;
+  for (int s = 0; s < CHUNK_SECTIONS; s++) {
+    job->builders[s].path = renderPath;
+  }
+  chunkSnapshotCreate(&job->snapshot, chunk);
+
+  chunk->dirtySections = 0;
+  chunk->meshJobs++;
+  meshJobCount++;
+  threadPoolSubmit(&workers, buildMeshJob, finishMeshJob, job);
+}
+
+// Check whether a chunk is worth meshing now: nearby, and no neighbor is about to change its border.
+static bool isChunkMeshable(const Chunk* chunk, const Camera* camera) {
+  Vec3 chunkCenter = getChunkCenter(&chunk->position);
+  Vec2i cameraXZ = {camera->position.x, camera->position.z};
+  Vec2i chunkXZ = {chunkCenter.x, chunkCenter.z};
+  if (vec2i_distance(&cameraXZ, &chunkXZ) > CHUNK_SIZE * RENDER_DISTANCE / 2) {
+    return false;
+  }
+
+  for (int face = 0; face < 6; face++) {
+    if (vec3iFaceMap[face].y != 0) {
+      continue;
+    }
+    Vec2i neighborPos = {chunk->position.a + vec3iFaceMap[face].x, chunk->position.b + vec3iFaceMap[face].z};
+    Chunk* neighbor = chunkMapGet(&chunks, &neighborPos);
+    if (neighbor && neighbor->state == CHUNK_GENERATING) {
+      return false; // Finishing the neighbor marks this chunk dirty again anyway
+    }
+  }
+  return true;
+}
+
+// Queue mesh builds for dirty chunks near the camera.
+static void submitMeshJobs(const Camera* camera) {
+  int iterator = 0;
+  Chunk* chunk;
+  while (meshJobCount < MESH_MAX_JOBS && (chunk = chunkMapNext(&chunks, &iterator))) {
+    // One build per chunk at a time, edits made during a build are picked up by the next one
+    if (chunk->state != CHUNK_READY || !chunk->dirtySections || chunk->meshJobs > 0 || !isChunkMeshable(chunk, camera)) {
+      continue;
+    }
+    submitMeshJob(chunk);
+  }
+}
+
+// Upload built meshes until the frame budget is spent. Meshes made stale by later changes are dropped
+// and their sections stay dirty, the next build of the chunk picks them up again.
+static void uploadMeshes() {
+  size_t uploaded = 0;
+  while (uploadHead && (uploaded == 0 || uploaded < MESH_UPLOAD_BUDGET)) {
+    MeshJob* job = uploadHead;
+    uploadHead = job->next;
+    if (!uploadHead) {
+      uploadTail = NULL;
+    }
+
+    Chunk* chunk = job->chunk;
+    if (!chunk->unloaded && job->version == chunk->version && job->mode == meshMode && job->path == renderPath) {
+      Vec3 origin = chunkToWorld(&chunk->position);
+      for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        if (job->sections >> s & 1) {
+          chunkMeshUpload(&chunk->meshes[s], &job->builders[s], &origin);
+          chunk->connectivity[s] = job->connectivity[s];
+          uploaded += meshBuilderByteSize(&job->builders[s]);
         }
       }
+      meshBuildSeconds += job->buildSeconds;
+      meshBuildCount++;
+    } else if (!chunk->unloaded) {
+      chunk->dirtySections |= job->sections;
+    }
+    releaseMeshJob(job);
+  }
+}
+
+static void addToDrawOrder(Chunk* chunk) {
+  if (drawOrderCount == drawOrderCapacity) {
+    int capacity = drawOrderCapacity ? drawOrderCapacity * 2 : 256;
+    DrawOrderEntry* entries = (DrawOrderEntry*)realloc(drawOrder, capacity * sizeof(DrawOrderEntry));
+    if (!entries) {
+      fprintf(stderr, "Failed to grow the chunk draw order to %d chunks\n", capacity);
+      return;
+    }
+    drawOrder = entries;
+    drawOrderCapacity = capacity;
+  }
+  drawOrder[drawOrderCount++] = (DrawOrderEntry){chunk, INFINITY};
+}
 
-      chunks[chunkI][chunkJ] = chunk;
+static void removeFromDrawOrder(const Chunk* chunk) {
+  for (int i = 0; i < drawOrderCount; i++) {
+    if (drawOrder[i].chunk == chunk) {
+      // Shift instead of swapping with the last entry to keep the list sorted
+      memmove(&drawOrder[i], &drawOrder[i + 1], (drawOrderCount - i - 1) * sizeof(DrawOrderEntry));
+      drawOrderCount--;
+      return;
     }
   }
 }
-void renderChunkGrid(GLuint shaderProgram, const Camera* camera) {
+
+static void sortDrawOrder(const Camera* camera) {
+  for (int i = 0; i < drawOrderCount; i++) {
+    Vec3 center = getChunkCenter(&drawOrder[i].chunk->position);
+    Vec3 offset;
+    vec3_subtract(&offset, &center, &camera->position);
+    drawOrder[i].distance2 = vec3_dot(&offset, &offset);
+  }
+  for (int i = 1; i < drawOrderCount; i++) {
+    DrawOrderEntry entry = drawOrder[i];
+    int j = i;
+    while (j > 0 && drawOrder[j - 1].distance2 > entry.distance2) {
+      drawOrder[j] = drawOrder[j - 1];
+      j--;
+    }
+    drawOrder[j] = entry;
+  }
+}
+
+// Check the batched terrain heights of a few chunks against getTerrainHeight, which samples perlin() one column at a time.
+static void checkTerrainHeights() {
+  static const Vec2i checkedChunks[] = {{0, 0}, {-1, -1}, {7, -3}, {-20, 11}};
+  int mismatches = 0;
+  for (int c = 0; c < (int)(sizeof(checkedChunks) / sizeof(checkedChunks[0])); c++) {
+    float heights[CHUNK_SIZE][CHUNK_SIZE];
+    getTerrainHeightGrid(&checkedChunks[c], heights);
+    for (int i = 0; i < CHUNK_SIZE; i++) {
+      for (int k = 0; k < CHUNK_SIZE; k++) {
+        float x = checkedChunks[c].a * CHUNK_SIZE * CUBE_SIZE + i * CUBE_SIZE;
+        float z = checkedChunks[c].b * CHUNK_SIZE * CUBE_SIZE + k * CUBE_SIZE;
+        mismatches += heights[i][k] != getTerrainHeight(x, z);
+      }
+    }
+  }
+  if (mismatches > 0) {
+    fprintf(stderr, "Batched terrain heights differ from getTerrainHeight in %d columns\n", mismatches);
+  }
+}
+
+// Chunk functions
+void initChunks() {
+  // The batched noise backends must reproduce the scalar terrain exactly
+  if (!perlinBatchCheckBackends()) {
+    fprintf(stderr, "Perlin noise backends disagree, terrain will differ between CPUs\n");
+  }
+  checkTerrainHeights();
+
+  // Chunks are streamed in around the camera, nothing is generated up front
+  chunkMapInit(&chunks, (2 * CHUNK_UNLOAD_RADIUS + 1) * (2 * CHUNK_UNLOAD_RADIUS + 1));
+  if (!threadPoolInit(&workers, getWorkerThreadCount())) {
+    fprintf(stderr, "Failed to start world generation workers\n");
+  }
+}
+
+// Add the chunk at the given chunk coordinates to the world and queue its generation.
+// The chunk stays invisible to getChunk until a worker finished it.
+Chunk* loadChunk(const Vec2i* chunkPos) {
+  Chunk* chunk = createChunk(chunkPos);
+  if (!chunk) {
+    return NULL;
+  }
+  if (!chunkMapInsert(&chunks, chunk)) {
+    destroyChunk(chunk);
+    return NULL;
+  }
+  addToDrawOrder(chunk);
+  threadPoolSubmit(&workers, generateChunkJob, finishChunkJob, chunk);
+  return chunk;
+}
+
+// Remove a chunk from the world and free it, or let the last job using it free it.
+void unloadChunk(Chunk* chunk) {
+  Vec2i chunkPos = chunk->position;
+  chunkMapRemove(&chunks, &chunkPos);
+  removeFromDrawOrder(chunk);
+  if (chunk->state == CHUNK_READY) {
+    markNeighborsDirty(&chunkPos);
+  }
+  if (chunk->state == CHUNK_GENERATING || chunk->meshJobs > 0) {
+    chunk->unloaded = true;
+    return;
+  }
+  destroyChunk(chunk);
+}
+
+// Check whether a chunk is loaded or being generated at the given chunk coordinates.
+bool hasChunk(const Vec2i* chunkPos) {
+  return chunkMapGet(&chunks, chunkPos) != NULL;
+}
+
+// Iterate over the loaded chunks, start with *iterator = 0. Returns NULL after the last chunk.
+Chunk* getNextChunk(int* iterator) {
+  return chunkMapNext(&chunks, iterator);
+}
+void renderChunkGrid(const ShaderProgram* shaderProgram, const Camera* camera) {
   static GLuint gridVAO = 0;
   static GLuint gridVBO = 0;
 
@@ -118,25 +531,15 @@ void renderChunkGrid(GLuint shaderProgram, const Camera* camera) {
     free(vertices);
   }
 
-  glUseProgram(shaderProgram);
+  glUseProgram(shaderProgram->id);
 
   // Set grid color (white)
-  glUniform3f(glGetUniformLocation(shaderProgram, "objectColor"), 0.3f, 0.3f, 0.3f);
-
-  // Calculate view and projection matrices
-  Mat4 view, projection;
-  Vec3 target;
-  vec3_add(&target, &camera->position, &camera->front);
-  mat4_lookAt(view, &camera->position, &target, &camera->up);
-  mat4_perspective(projection, 70.0f, 1920.0f / 1080.0f, 0.1f, 1000.0f);
-
-  // Set matrices in shader
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, view);
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, projection);
+  glUniform3f(shaderProgram->uniforms[UNIFORM_OBJECT_COLOR], 0.3f, 0.3f, 0.3f);
 
+  // View and projection come from the frame uniforms
   Mat4 model;
   mat4_identity(model);
-  glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
+  setModelMatrix(shaderProgram, model);
 
   // Draw grid
   glBindVertexArray(gridVAO);
@@ -144,41 +547,29 @@ void renderChunkGrid(GLuint shaderProgram, const Camera* camera) {
   glBindVertexArray(0);
 }
 void cleanupChunks() {
-  for (int x = 0; x < CHUNKS_PER_AXIS; x++) {
-    for (int z = 0; z < CHUNKS_PER_AXIS; z++) {
-      free(chunks[x][z]);
-    }
-    free(chunks[x]);
+  // Let the workers finish so no chunk is freed while it is being written
+  threadPoolDestroy(&workers);
+  while (uploadHead) {
+    MeshJob* job = uploadHead;
+    uploadHead = job->next;
+    releaseMeshJob(job);
   }
-  free(chunks);
-}
-
-static const GLfloat cubeVerticesWithNormals[] = {
-    // Front face
-    // Positions          // Normals           // Texture Coords
-    // Good look reading this LMAO
-    -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, 0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f, 0.5f, 0.5f, 0.5f, 0.0f, 0.0f,
-    1.0f, 1.0f, 0.0f, -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+  uploadTail = NULL;
 
-    // Back face
-    0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f, -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, -0.5f, 0.5f, -0.5f,
-    0.0f, 0.0f, -1.0f, 1.0f, 0.0f, -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f, 0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
-
-    // Top face
-    -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, 0.5f, 0.5f, 0.5f, 0.0f, 1.0f,
-    0.0f, 1.0f, 1.0f, -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
-
-    // Bottom face
-    -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f, 0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.5f, -0.5f, 0.5f,
-    0.0f, -1.0f, 0.0f, 1.0f, 0.0f, -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
-
-    // Right face
-    0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f,
-    0.0f, 1.0f, 0.0f, 0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
-
-    // Left face
-    -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f, -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f, -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -0.5f, 0.5f, 0.5f,
-    -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f};
+  int iterator = 0;
+  Chunk* chunk;
+  while ((chunk = chunkMapNext(&chunks, &iterator))) {
+    destroyChunk(chunk);
+  }
+  chunkMapFree(&chunks);
+  free(drawOrder);
+  drawOrder = NULL;
+  drawOrderCount = 0;
+  drawOrderCapacity = 0;
+  free(visitQueue);
+  visitQueue = NULL;
+  visitQueueCapacity = 0;
+}
 
 static BiomeParameters biomeParameters[] = { // Plains biome - flatter, lower amplitude
     {0.03f, 0.5f, 0.3f, 4.0f},               // Lower frequency and amplitude for flatter terrain
@@ -189,8 +580,7 @@ static float getBiomeBlendFactor(float x, float z) {
   float biomeNoise = perlin(x * 0.02f, 0, z * 0.02f);
   return smoothstep(0.4f, 0.6f, biomeNoise);
 }
-BiomeParameters getInterpolatedBiomeParameters(float x, float z) {
-  float blendFactor = getBiomeBlendFactor(x, z);
+static BiomeParameters blendBiomeParameters(float blendFactor) {
   BiomeParameters result;
 
   result.frequency = lerp(biomeParameters[BIOME_PLAINS].frequency, biomeParameters[BIOME_HILLS].frequency, blendFactor);
@@ -200,7 +590,10 @@ BiomeParameters getInterpolatedBiomeParameters(float x, float z) {
 
   return result;
 }
-// Add this function to get height based on biome
+BiomeParameters getInterpolatedBiomeParameters(float x, float z) {
+  return blendBiomeParameters(getBiomeBlendFactor(x, z));
+}
+// Terrain height of one column, sampled one octave at a time. Reference for the batched heights, see checkTerrainHeights
 float getTerrainHeight(float x, float z) {
   BiomeParameters params = getInterpolatedBiomeParameters(x, z);
   float height = 0.0f;
@@ -216,6 +609,147 @@ float getTerrainHeight(float x, float z) {
 
   return height * params.heightScale;
 }
+// Terrain height at count columns, same values as getTerrainHeight but with the noise of all columns sampled at once.
+static void sampleTerrainHeights(const float* worldX, const float* worldZ, float* heights, int count) {
+  float sampleX[TERRAIN_SAMPLES_MAX], sampleZ[TERRAIN_SAMPLES_MAX], noise[TERRAIN_SAMPLES_MAX];
+  float amplitude[TERRAIN_SAMPLES_MAX], frequency[TERRAIN_SAMPLES_MAX];
+  BiomeParameters params[TERRAIN_SAMPLES_MAX];
+
+  // Biome blend, see getBiomeBlendFactor
+  for (int c = 0; c < count; c++) {
+    sampleX[c] = worldX[c] * 0.02f;
+    sampleZ[c] = worldZ[c] * 0.02f;
+  }
+  perlinBatch(sampleX, 0, sampleZ, noise, count);
+  for (int c = 0; c < count; c++) {
+    params[c] = blendBiomeParameters(smoothstep(0.4f, 0.6f, noise[c]));
+    heights[c] = 0.0f;
+    amplitude[c] = params[c].amplitude;
+    frequency[c] = params[c].frequency;
+  }
+
+  // Octaves, see getTerrainHeight
+  for (int octave = 0; octave < 4; octave++) {
+    for (int c = 0; c < count; c++) {
+      sampleX[c] = worldX[c] * frequency[c];
+      sampleZ[c] = worldZ[c] * frequency[c];
+    }
+    perlinBatch(sampleX, 0, sampleZ, noise, count);
+    for (int c = 0; c < count; c++) {
+      heights[c] += noise[c] * amplitude[c];
+      amplitude[c] *= params[c].persistence;
+      frequency[c] *= 2.0f;
+    }
+  }
+
+  for (int c = 0; c < count; c++) {
+    heights[c] *= params[c].heightScale;
+  }
+}
+
+// Terrain height of every column of a chunk, indexed [x][z], sampled at full resolution.
+void getTerrainHeightGrid(const Vec2i* chunkPos, float heights[CHUNK_SIZE][CHUNK_SIZE]) {
+  float worldX[CHUNK_SIZE * CHUNK_SIZE], worldZ[CHUNK_SIZE * CHUNK_SIZE];
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      worldX[i * CHUNK_SIZE + k] = chunkPos->a * CHUNK_SIZE * CUBE_SIZE + i * CUBE_SIZE;
+      worldZ[i * CHUNK_SIZE + k] = chunkPos->b * CHUNK_SIZE * CUBE_SIZE + k * CUBE_SIZE;
+    }
+  }
+  sampleTerrainHeights(worldX, worldZ, &heights[0][0], CHUNK_SIZE * CHUNK_SIZE);
+}
+
+// Terrain height of every column of a chunk, sampled on a lattice every spacing columns and bilinearly interpolated in between.
+// The lattice includes the first column of the next chunk, so neighboring chunks meet without seams.
+void getTerrainHeightGridSampled(const Vec2i* chunkPos, int spacing, float heights[CHUNK_SIZE][CHUNK_SIZE]) {
+  if (spacing <= 1 || CHUNK_SIZE % spacing != 0) {
+    getTerrainHeightGrid(chunkPos, heights);
+    return;
+  }
+
+  int points = CHUNK_SIZE / spacing + 1;
+  float worldX[TERRAIN_SAMPLES_MAX], worldZ[TERRAIN_SAMPLES_MAX], lattice[TERRAIN_SAMPLES_MAX];
+  for (int li = 0; li < points; li++) {
+    for (int lk = 0; lk < points; lk++) {
+      worldX[li * points + lk] = chunkPos->a * CHUNK_SIZE * CUBE_SIZE + li * spacing * CUBE_SIZE;
+      worldZ[li * points + lk] = chunkPos->b * CHUNK_SIZE * CUBE_SIZE + lk * spacing * CUBE_SIZE;
+    }
+  }
+  sampleTerrainHeights(worldX, worldZ, lattice, points * points);
+
+  for (int i = 0; i < CHUNK_SIZE; i++) {
+    int li = i / spacing;
+    float fi = (float)(i % spacing) / spacing;
+    for (int k = 0; k < CHUNK_SIZE; k++) {
+      int lk = k / spacing;
+      float fk = (float)(k % spacing) / spacing;
+      float near = lerp(lattice[li * points + lk], lattice[(li + 1) * points + lk], fi);
+      float far = lerp(lattice[li * points + lk + 1], lattice[(li + 1) * points + lk + 1], fi);
+      heights[i][k] = lerp(near, far, fk);
+    }
+  }
+}
+
+// Compare lattice sampled terrain against full resolution terrain over the chunks within radius of center.
+TerrainSampleError measureTerrainSampleError(const Vec2i* center, int radius, int spacing) {
+  TerrainSampleError error = {0.0f, 0.0f, 0.0f};
+  float exact[CHUNK_SIZE][CHUNK_SIZE], sampled[CHUNK_SIZE][CHUNK_SIZE];
+  double totalError = 0.0;
+  int changed = 0;
+  int columns = 0;
+
+  for (int dx = -radius; dx <= radius; dx++) {
+    for (int dz = -radius; dz <= radius; dz++) {
+      Vec2i chunkPos = {center->a + dx, center->b + dz};
+      getTerrainHeightGrid(&chunkPos, exact);
+      getTerrainHeightGridSampled(&chunkPos, spacing, sampled);
+      for (int i = 0; i < CHUNK_SIZE; i++) {
+        for (int k = 0; k < CHUNK_SIZE; k++) {
+          float difference = fabsf(sampled[i][k] - exact[i][k]);
+          totalError += difference;
+          error.maxError = difference > error.maxError ? difference : error.maxError;
+          // Columns whose surface block moved are the visible part of the error
+          changed += floorf(sampled[i][k]) != floorf(exact[i][k]);
+          columns++;
+        }
+      }
+    }
+  }
+
+  error.meanError = (float)(totalError / columns);
+  error.changedColumns = (float)changed / columns;
+  return error;
+}
+
+// Switch the lattice spacing new chunks are generated with, spacing must divide CHUNK_SIZE.
+// Every chunk is unloaded so the world streams back in with the new terrain.
+void setTerrainSampleSpacing(int spacing) {
+  if (spacing < 1 || CHUNK_SIZE % spacing != 0) {
+    fprintf(stderr, "Terrain sample spacing %d does not divide the chunk size\n", spacing);
+    return;
+  }
+  atomic_store(&terrainSampleSpacing, spacing);
+
+  // Collect first, removing from the map while iterating it would skip entries
+  int count = 0;
+  Chunk** loaded = (Chunk**)malloc(chunks.count * sizeof(Chunk*));
+  if (!loaded) {
+    fprintf(stderr, "Failed to allocate chunk list\n");
+    return;
+  }
+  int iterator = 0;
+  Chunk* chunk;
+  while ((chunk = chunkMapNext(&chunks, &iterator))) {
+    loaded[count++] = chunk;
+  }
+  for (int i = 0; i < count; i++) {
+    unloadChunk(loaded[i]);
+  }
+  free(loaded);
+}
+int getTerrainSampleSpacing() {
+  return atomic_load(&terrainSampleSpacing);
+}
 const char* getCurrentBiomeText(float x, float z) {
   float blendFactor = getBiomeBlendFactor(x, z);
   if (blendFactor < 0.4f) {
@@ -228,202 +762,658 @@ const char* getCurrentBiomeText(float x, float z) {
 }
 
 void initWorld() {
-  glGenVertexArrays(1, &VAO);
-  glGenBuffers(1, &VBO);
-
-  glBindVertexArray(VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerticesWithNormals), cubeVerticesWithNormals, GL_STATIC_DRAW);
+  // Load textures
+  const char* texturePaths[BLOCK_TEXTURE_COUNT] = {
+      [TEXTURE_STONE] = "assets/textures/stone.png",
+      [TEXTURE_DIRT] = "assets/textures/dirt.png",
+      [TEXTURE_GRASS_TOP] = "assets/textures/grass-top.png",
+      [TEXTURE_GRASS_SIDE] = "assets/textures/grass-side.png",
+  };
+  blockTextures = loadTextureArray(texturePaths, BLOCK_TEXTURE_COUNT);
+  chunkMeshesInit();
+  glGenQueries(2, overdrawQueries);
+
+  bool vertexShaderLoaded = loadShaderProgram(&chunkShaders[RENDER_VERTICES], "assets/shaders/voxel_vertex_shader.glsl", "assets/shaders/fragment_shader.glsl");
+  bool faceShaderLoaded = loadShaderProgram(&chunkShaders[RENDER_FACES], "assets/shaders/face_vertex_shader.glsl", "assets/shaders/fragment_shader.glsl");
+  if (!vertexShaderLoaded || !faceShaderLoaded) {
+    fprintf(stderr, "Failed to load chunk shaders\n");
+    return;
+  }
 
-  // Position attribute
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)0);
+  // Occlusion queries draw a unit cube scaled onto each chunk, conservative queries let the GPU answer earlier
+  if (!loadShaderProgram(&boundsShader, "assets/shaders/bounds_vertex_shader.glsl", "assets/shaders/bounds_fragment_shader.glsl")) {
+    fprintf(stderr, "Failed to load the bounding box shader, occlusion culling stays off\n");
+  }
+  occlusionTarget = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility ? GL_ANY_SAMPLES_PASSED_CONSERVATIVE : GL_ANY_SAMPLES_PASSED;
+  conditionalRender = GLEW_VERSION_3_0 || GLEW_NV_conditional_render;
+  GLfloat boxVertices[6 * CUBE_FACE_VERTICES][3];
+  for (int face = 0; face < 6; face++) {
+    const GLfloat* vertices = getCubeFaceVertices(face);
+    for (int v = 0; v < CUBE_FACE_VERTICES; v++) {
+      for (int axis = 0; axis < 3; axis++) {
+        boxVertices[face * CUBE_FACE_VERTICES + v][axis] = vertices[v * CUBE_VERTEX_FLOATS + axis];
+      }
+    }
+  }
+  glGenVertexArrays(1, &boundsVAO);
+  glGenBuffers(1, &boundsVBO);
+  glBindVertexArray(boundsVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, boundsVBO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(boxVertices), boxVertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
   glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
 
-  // Normal attribute
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(1);
+  // The face shader builds quads from the cube face table, passed in with corners moved to 0..1
+  GLfloat cornerPositions[6 * CUBE_FACE_VERTICES][3];
+  GLfloat cornerTexCoords[6 * CUBE_FACE_VERTICES][2];
+  for (int face = 0; face < 6; face++) {
+    const GLfloat* vertices = getCubeFaceVertices(face);
+    for (int v = 0; v < CUBE_FACE_VERTICES; v++) {
+      const GLfloat* vertex = vertices + v * CUBE_VERTEX_FLOATS;
+      int c = face * CUBE_FACE_VERTICES + v;
+      for (int axis = 0; axis < 3; axis++) {
+        cornerPositions[c][axis] = vertex[axis] + 0.5f;
+      }
+      cornerTexCoords[c][0] = vertex[6];
+      cornerTexCoords[c][1] = vertex[7];
+    }
+  }
+  const ShaderProgram* faceShader = &chunkShaders[RENDER_FACES];
+  glUseProgram(faceShader->id);
+  glUniform3fv(faceShader->uniforms[UNIFORM_CORNER_POSITIONS], 6 * CUBE_FACE_VERTICES, &cornerPositions[0][0]);
+  glUniform2fv(faceShader->uniforms[UNIFORM_CORNER_TEX_COORDS], 6 * CUBE_FACE_VERTICES, &cornerTexCoords[0][0]);
+  glUniform1i(faceShader->uniforms[UNIFORM_FACES], 1);
+
+  // Texture units never change, block textures are on unit 0 and the mesh page table on unit 2
+  for (int path = 0; path < RENDER_PATH_COUNT; path++) {
+    glUseProgram(chunkShaders[path].id);
+    glUniform1i(chunkShaders[path].uniforms[UNIFORM_BLOCK_TEXTURES], 0);
+    glUniform1i(chunkShaders[path].uniforms[UNIFORM_CHUNK_PAGES], 2);
+  }
+  glUseProgram(0);
+}
 
-  // Texture coordinate attribute
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
-  glEnableVertexAttribArray(2);
+// Switch the mesher used for chunk geometry and rebuild every chunk with it.
+void setMeshMode(MeshMode mode) {
+  meshMode = mode;
+  meshBuildSeconds = 0.0;
+  meshBuildCount = 0;
+  int iterator = 0;
+  Chunk* chunk;
+  while ((chunk = chunkMapNext(&chunks, &iterator))) {
+    markChunkDirty(chunk);
+  }
+}
+MeshMode getMeshMode() {
+  return meshMode;
+}
 
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
+// Switch how chunk geometry is stored on the GPU and rebuild every chunk for it.
+// Chunks keep drawing their old mesh with its own shader until the rebuild is uploaded.
+void setRenderPath(RenderPath path) {
+  renderPath = path;
+  int iterator = 0;
+  Chunk* chunk;
+  while ((chunk = chunkMapNext(&chunks, &iterator))) {
+    markChunkDirty(chunk);
+  }
+}
+RenderPath getRenderPath() {
+  return renderPath;
+}
 
-  // Load textures
-  stoneTexture = loadTexture("assets/textures/stone.png");
-  dirtTexture = loadTexture("assets/textures/dirt.png");
-  grassTopTexture = loadTexture("assets/textures/grass-top.png");
-  grassSideTexture = loadTexture("assets/textures/grass-side.png");
+// Turning sorting off puts chunks back in chunk map order, which is how they were drawn before sorting
+void setChunkSorting(bool enabled) {
+  chunkSorting = enabled;
+  if (!enabled) {
+    int iterator = 0;
+    Chunk* chunk;
+    drawOrderCount = 0;
+    while ((chunk = chunkMapNext(&chunks, &iterator))) {
+      addToDrawOrder(chunk);
+    }
+  }
+}
+bool getChunkSorting() {
+  return chunkSorting;
 }
 
-RenderResult renderWorld(GLuint shaderProgram, const Camera* camera) {
-  int visibleCubes = 0; // Reset counter
+void setOcclusionCulling(bool enabled) {
+  occlusionCulling = enabled && boundsShader.id != 0;
+}
+bool getOcclusionCulling() {
+  return occlusionCulling;
+}
 
-  // Create and update frustum
-  Frustum frustum;
-  Mat4 projection, view;
-  mat4_perspective(projection, 70.0f, 1920.0f / 1080.0f, 0.1f, 1000.0f);
+void setSoftwareCulling(bool enabled) {
+  softwareCulling = enabled;
+}
+bool getSoftwareCulling() {
+  return softwareCulling;
+}
 
-  Vec3 target;
-  vec3_add(&target, &camera->position, &camera->front);
-  mat4_lookAt(view, &camera->position, &target, &camera->up);
+void setCaveCulling(bool enabled) {
+  caveCulling = enabled;
+}
+bool getCaveCulling() {
+  return caveCulling;
+}
+
+// Build the view frustum the world is rendered with.
+static void getCameraFrustum(Frustum* frustum, const Camera* camera) {
+  Mat4 projection, view;
+  getCameraProjectionMatrix(projection);
+  getCameraViewMatrix(camera, view);
+  frustum_update(frustum, projection, view);
+}
 
-  frustum_update(&frustum, projection, view);
+// Upload the camera and light data of the frame, call once per frame before anything is drawn.
+void uploadFrameUniforms(const Camera* camera) {
+  FrameUniforms frame;
+  getCameraViewMatrix(camera, frame.view);
+  getCameraProjectionMatrix(frame.projection);
+  frame.viewPos[0] = camera->position.x;
+  frame.viewPos[1] = camera->position.y;
+  frame.viewPos[2] = camera->position.z;
+  frame.viewPos[3] = 1.0f;
 
   // Set light properties
-  Vec3 lightPos = {5.0f, 50.0f, 5.0f};
-  Vec3 lightColor = {1.0f, 1.0f, 1.0f};
+  const GLfloat lightPos[4] = {5.0f, 50.0f, 5.0f, 1.0f};
+  const GLfloat lightColor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  memcpy(frame.lightPos, lightPos, sizeof(lightPos));
+  memcpy(frame.lightColor, lightColor, sizeof(lightColor));
+  updateFrameUniforms(&frame);
+}
+
+// Stream chunks in and out around the camera and keep their meshes up to date, call once per frame before rendering.
+StreamStats updateWorld(const Camera* camera) {
+  // Take in the chunks and meshes the workers finished since the last frame
+  threadPoolPoll(&workers, -1);
 
-  glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, (float*)&lightPos);
-  glUniform3fv(glGetUniformLocation(shaderProgram, "lightColor"), 1, (float*)&lightColor);
-  glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, (float*)&camera->position);
+  Frustum frustum;
+  getCameraFrustum(&frustum, camera);
+  StreamStats stats = streamChunks(camera, &frustum);
+
+  submitMeshJobs(camera);
+  uploadMeshes();
+  return stats;
+}
 
-  glBindVertexArray(VAO);
+static void getSectionBounds(const Chunk* chunk, int section, Vec3* center, Vec3* dimensions) {
+  *center = getChunkCenter(&chunk->position);
+  center->y = (section + 0.5f) * SECTION_HEIGHT * CUBE_SIZE;
+  *dimensions = (Vec3){CHUNK_SIZE * CUBE_SIZE, SECTION_HEIGHT * CUBE_SIZE, CHUNK_SIZE * CUBE_SIZE};
+}
 
-  const float RENDER_DISTANCE = 4.0f;
+static bool isInRenderDistance(const Vec2i* chunkPos, const Camera* camera) {
+  Vec3 chunkCenter = getChunkCenter(chunkPos);
+  Vec2i cameraXZ = {camera->position.x, camera->position.z};
+  Vec2i chunkXZ = {chunkCenter.x, chunkCenter.z};
+  return vec2i_distance(&cameraXZ, &chunkXZ) <= CHUNK_SIZE * RENDER_DISTANCE / 2;
+}
 
-  for (int x = 0; x < CHUNKS_PER_AXIS; x++) {
-    for (int z = 0; z < CHUNKS_PER_AXIS; z++) {
-      Chunk* chunk = chunks[x][z];
+// Breadth first walk over chunk sections from the one holding the camera, marking every section it reaches
+// with the current visitFrame. A step leaves a section only through a face its air connects to the face
+// the walk came in through, never moves against a direction it already took, and stays in the frustum.
+// Sections behind hills or under ground are never reached. Returns false when the camera is outside every
+// loaded section, the caller then has to draw without the walk.
+static bool walkVisibleSections(const Frustum* frustum, const Camera* camera) {
+  visitFrame++;
+  Vec3i cameraBlock = {(int)floorf(camera->position.x), (int)floorf(camera->position.y), (int)floorf(camera->position.z)};
+  if (cameraBlock.y < 0 || cameraBlock.y >= CHUNK_HEIGHT) {
+    return false;
+  }
+  Vec2i cameraChunk = blockToChunk(&cameraBlock);
+  Chunk* start = chunkMapGet(&chunks, &cameraChunk);
+  if (!start) {
+    return false;
+  }
 
-      // check if chunk out of render distance
-      Vec3 chunkWorldCoords = chunkToWorld(&chunk->position);
+  // Every section is queued at most once per walk
+  int capacity = drawOrderCount * CHUNK_SECTIONS;
+  if (capacity > visitQueueCapacity) {
+    SectionVisit* queue = (SectionVisit*)realloc(visitQueue, capacity * sizeof(SectionVisit));
+    if (!queue) {
+      fprintf(stderr, "Failed to grow the section visit queue to %d sections\n", capacity);
+      return false;
+    }
+    visitQueue = queue;
+    visitQueueCapacity = capacity;
+  }
+
+  int head = 0;
+  int tail = 0;
+  int startSection = cameraBlock.y / SECTION_HEIGHT;
+  start->visitFrame[startSection] = visitFrame;
+  visitQueue[tail++] = (SectionVisit){start, startSection, -1, 0};
+  while (head < tail) {
+    SectionVisit visit = visitQueue[head++];
+    for (int face = 0; face < 6; face++) {
+      int opposite = face ^ 1; // Faces come in opposite pairs, see vec3iFaceMap
+      if (visit.directions >> opposite & 1) {
+        continue;
+      }
+      if (visit.entryFace >= 0 && !sectionFacesConnected(visit.chunk->connectivity[visit.section], visit.entryFace, face)) {
+        continue;
+      }
+      int section = visit.section + vec3iFaceMap[face].y;
+      if (section < 0 || section >= CHUNK_SECTIONS) {
+        continue;
+      }
+      Chunk* chunk = visit.chunk;
+      if (vec3iFaceMap[face].y == 0) {
+        Vec2i chunkPos = {chunk->position.a + vec3iFaceMap[face].x, chunk->position.b + vec3iFaceMap[face].z};
+        chunk = chunkMapGet(&chunks, &chunkPos);
+        if (!chunk || !isInRenderDistance(&chunkPos, camera)) {
+          continue;
+        }
+      }
+      if (chunk->visitFrame[section] == visitFrame) {
+        continue;
+      }
+
+      Vec3 center, dimensions;
+      getSectionBounds(chunk, section, &center, &dimensions);
+      if (!frustum_block_visible(frustum, &center, &dimensions, camera)) {
+        continue;
+      }
+
+      // Chunks still generating have no blocks yet, the walk passes through them as air
+      chunk->visitFrame[section] = visitFrame;
+      visitQueue[tail++] = (SectionVisit){chunk, section, opposite, visit.directions | 1u << face};
+    }
+  }
+  return true;
+}
+
+// Read the last occlusion query of a chunk without waiting and queue a new one when none is in flight.
+// Chunks around the camera are always visible, the near plane can clip their box away.
+static OcclusionState updateChunkOcclusion(Chunk* chunk, const Vec3* center, const Vec3* dimensions, const Camera* camera) {
+  bool stale = chunk->occlusionFrame + 1 != renderFrame; // Not tested last frame, so the last result is from an older view
+  chunk->occlusionFrame = renderFrame;
+  if (chunk->occlusionPending) {
+    GLuint available;
+    glGetQueryObjectuiv(chunk->occlusionQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint samples;
+      glGetQueryObjectuiv(chunk->occlusionQuery, GL_QUERY_RESULT, &samples);
+      chunk->occluded = samples == 0;
+      chunk->occlusionPending = false;
+    }
+  }
+
+  bool aroundCamera = fabsf(camera->position.x - center->x) < dimensions->x / 2 + 1.0f && fabsf(camera->position.y - center->y) < dimensions->y / 2 + 1.0f &&
+                      fabsf(camera->position.z - center->z) < dimensions->z / 2 + 1.0f;
+  if (stale || aroundCamera) {
+    chunk->occluded = false;
+  }
+  if (aroundCamera) {
+    return OCCLUSION_VISIBLE;
+  }
+  if (chunk->occlusionPending) {
+    if (stale) {
+      return OCCLUSION_VISIBLE;
+    }
+    if (conditionalRender) {
+      return OCCLUSION_PENDING;
+    }
+    return chunk->occluded ? OCCLUSION_HIDDEN : OCCLUSION_VISIBLE;
+  }
+
+  if (chunk->occlusionQuery == 0) {
+    glGenQueries(1, &chunk->occlusionQuery);
+  }
+  occlusionTests[occlusionTestCount++] = chunk;
+  return chunk->occluded ? OCCLUSION_HIDDEN : OCCLUSION_VISIBLE;
+}
+
+// Draw the bounding box of every chunk queued for a test inside its query, without touching color or depth.
+// Boxes grow by a little so they never sit exactly on the faces they enclose.
+static void drawOcclusionTests() {
+  if (occlusionTestCount == 0) {
+    return;
+  }
+  glUseProgram(boundsShader.id);
+  glBindVertexArray(boundsVAO);
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glDepthMask(GL_FALSE);
+  for (int i = 0; i < occlusionTestCount; i++) {
+    Chunk* chunk = occlusionTests[i];
+    Vec3 center, dimensions;
+    chunkGetSolidBounds(chunk, &center, &dimensions);
+    Mat4 model;
+    mat4_identity(model);
+    model[0] = dimensions.x + 0.1f;
+    model[5] = dimensions.y + 0.1f;
+    model[10] = dimensions.z + 0.1f;
+    model[12] = center.x;
+    model[13] = center.y;
+    model[14] = center.z;
+    glUniformMatrix4fv(boundsShader.uniforms[UNIFORM_MODEL], 1, GL_FALSE, model);
+
+    glBeginQuery(occlusionTarget, chunk->occlusionQuery);
+    glDrawArrays(GL_TRIANGLES, 0, 6 * CUBE_FACE_VERTICES);
+    glEndQuery(occlusionTarget);
+    chunk->occlusionPending = true;
+  }
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glDepthMask(GL_TRUE);
+  glBindVertexArray(0);
+  occlusionTestCount = 0;
+}
+
+// Draw the solid ground of a chunk into the software depth buffer. Every OCCLUDER_COLUMNS square of columns becomes
+// one box reaching up to the lowest height its columns are solid to from the bottom of the world without a gap,
+// so the boxes are solid all the way through even where the terrain has been dug into.
+static void drawChunkOccluders(OccluderBuffer* buffer, const Chunk* chunk) {
+  Vec3 origin = chunkToWorld(&chunk->position);
+  for (int x = 0; x < CHUNK_SIZE; x += OCCLUDER_COLUMNS) {
+    for (int z = 0; z < CHUNK_SIZE; z += OCCLUDER_COLUMNS) {
+      int height = CHUNK_HEIGHT;
+      for (int i = x; i < x + OCCLUDER_COLUMNS; i++) {
+        for (int k = z; k < z + OCCLUDER_COLUMNS; k++) {
+          uint64_t open = ~chunk->solidColumns[i][k];
+          int solid = open ? __builtin_ctzll(open) : CHUNK_HEIGHT;
+          height = solid < height ? solid : height;
+        }
+      }
+      if (height == 0) {
+        continue;
+      }
+      Vec3 center = {origin.x + (x + OCCLUDER_COLUMNS / 2.0f) * CUBE_SIZE, height * CUBE_SIZE / 2.0f, origin.z + (z + OCCLUDER_COLUMNS / 2.0f) * CUBE_SIZE};
+      Vec3 sizes = {OCCLUDER_COLUMNS * CUBE_SIZE, height * CUBE_SIZE, OCCLUDER_COLUMNS * CUBE_SIZE};
+      occluderBufferDrawBox(buffer, &center, &sizes);
+    }
+  }
+}
+
+// Queue the meshes of the sections of a chunk set in sections, in the given section order
+static void queueChunkSections(const Chunk* chunk, unsigned sections, const int sectionOrder[CHUNK_SECTIONS], int* visibleCubes, int* triangles) {
+  for (int n = 0; n < CHUNK_SECTIONS; n++) {
+    int s = sectionOrder[n];
+    if (sections >> s & 1) {
+      chunkMeshQueueDraw(&chunk->meshes[s]);
+      *visibleCubes += chunk->meshes[s].blockCount;
+      *triangles += chunk->meshes[s].vertexCount / 3;
+    }
+  }
+}
+
+RenderResult renderWorld(const Camera* camera) {
+  int visibleCubes = 0; // Reset counter
+  int triangles = 0;
+
+  // Create and update frustum
+  Frustum frustum;
+  getCameraFrustum(&frustum, camera);
+
+  // Every chunk samples the same texture array on unit 0, so it is bound once per frame
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, blockTextures);
+
+  // Sections of a chunk are queued from the camera height outwards
+  int cameraSection = (int)floorf(camera->position.y) / SECTION_HEIGHT;
+  cameraSection = cameraSection < 0 ? 0 : cameraSection >= CHUNK_SECTIONS ? CHUNK_SECTIONS - 1 : cameraSection;
+  int sectionOrder[CHUNK_SECTIONS];
+  int sectionCount = 0;
+  sectionOrder[sectionCount++] = cameraSection;
+  for (int d = 1; sectionCount < CHUNK_SECTIONS; d++) {
+    if (cameraSection - d >= 0) {
+      sectionOrder[sectionCount++] = cameraSection - d;
+    }
+    if (cameraSection + d < CHUNK_SECTIONS) {
+      sectionOrder[sectionCount++] = cameraSection + d;
+    }
+  }
+
+  if (chunkSorting) {
+    sortDrawOrder(camera);
+  }
+  bool walked = caveCulling && walkVisibleSections(&frustum, camera);
+  int frustumCulled = 0;
+  int caveCulled = 0;
+  int occlusionCulled = 0;
+
+  renderFrame++;
+  if (drawOrderCount > occlusionCapacity) {
+    Chunk** tests = (Chunk**)realloc(occlusionTests, drawOrderCount * sizeof(Chunk*));
+    if (tests) {
+      occlusionTests = tests;
+    }
+    ChunkDraw* draws = (ChunkDraw*)realloc(pendingDraws, drawOrderCount * sizeof(ChunkDraw));
+    if (draws) {
+      pendingDraws = draws;
+    }
+    if (tests && draws) {
+      occlusionCapacity = drawOrderCount;
+    } else {
+      fprintf(stderr, "Failed to grow the occlusion query lists to %d chunks\n", drawOrderCount);
+    }
+  }
+  bool occlusionTested = occlusionCulling && occlusionCapacity >= drawOrderCount;
+
+  // The nearest chunks become occluders for all the others, the clip matrix comes from the frustum
+  int softwareCulled = 0;
+  if (softwareCulling) {
+    occluderBufferBegin(&occluderBuffer, &frustum);
+    for (int i = 0; i < drawOrderCount; i++) {
+      Chunk* chunk = drawOrder[i].chunk;
       Vec3 chunkCenter = getChunkCenter(&chunk->position);
       Vec2i cameraXZ = {camera->position.x, camera->position.z};
       Vec2i chunkXZ = {chunkCenter.x, chunkCenter.z};
-
-      if (vec2i_distance(&cameraXZ, &chunkXZ) > CHUNK_SIZE * RENDER_DISTANCE / 2) {
+      Vec3 solidCenter, solidDimensions;
+      if (chunk->state != CHUNK_READY || vec2i_distance(&cameraXZ, &chunkXZ) > OCCLUDER_DISTANCE || !chunkGetSolidBounds(chunk, &solidCenter, &solidDimensions) ||
+          !frustum_block_visible(&frustum, &solidCenter, &solidDimensions, camera)) {
         continue;
       }
-      Vec3 chunkDimensions = CHUNK_DIMENSIONS;
+      drawChunkOccluders(&occluderBuffer, chunk);
+    }
+    occluderBufferFinish(&occluderBuffer);
+  }
 
-      // Check if the chunk is in the view frustum
-      bool chunkVisible = frustum_block_visible(&frustum, &chunkCenter, &chunkDimensions, camera);
-      if (!chunkVisible) {
-        continue;
+  for (int i = 0; i < drawOrderCount; i++) {
+    Chunk* chunk = drawOrder[i].chunk;
+    if (chunk->state != CHUNK_READY || !isInRenderDistance(&chunk->position, camera)) {
+      continue;
+    }
+
+    // Check if the non empty part of the chunk is in the view frustum, empty sections are never drawn
+    Vec3 solidCenter, solidDimensions;
+    if (!chunkGetSolidBounds(chunk, &solidCenter, &solidDimensions)) {
+      continue;
+    }
+    bool chunkVisible = frustum_block_visible(&frustum, &solidCenter, &solidDimensions, camera);
+    if (!chunkVisible) {
+      frustumCulled++;
+      continue;
+    }
+
+    unsigned sections = CHUNK_ALL_SECTIONS;
+    if (walked) {
+      sections = 0;
+      for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        sections |= (unsigned)(chunk->visitFrame[s] == visitFrame) << s;
       }
-      // Add alternating color pattern for chunks
-      Vec3 chunkColor;
-      if ((x + z) % 2 == 0) {
-        chunkColor.x = 1.0f; // More reddish
-        chunkColor.y = 0.8f;
-        chunkColor.z = 0.8f;
-      } else {
-        chunkColor.x = 0.8f; // More bluish
-        chunkColor.y = 0.8f;
-        chunkColor.z = 1.0f;
+      if (!sections) {
+        caveCulled++;
+        continue;
       }
+    }
 
-      // Render each block in the chunk
-      for (int i = 0; i < CHUNK_SIZE; i++) {
-        for (int j = 0; j < CHUNK_HEIGHT; j++) {
-          for (int k = 0; k < CHUNK_SIZE; k++) {
-            Block* block = &chunk->blocks[i][j][k];
-            if (block->id == BLOCK_AIR) {
-              continue;
-            }
-            Vec3i pos = {chunkWorldCoords.x + i * CUBE_SIZE, j * CUBE_SIZE, chunkWorldCoords.z + k * CUBE_SIZE};
-            // printf("p: %d, %d, %d chunk: %d,%d world: %d,%d,%d type:%d\n", i, j, k, x, z, pos.x, pos.y, pos.z, block->id);
-
-            // bool occluded = is_block_occluded(&pos, CUBE_SIZE, camera);
-
-            // if (occluded) {
-            //  continue;
-            //}
-            if (!block->checkedNeighbors) {
-              block->checkedNeighbors = true;
-              for (int face = 0; face < 6; face++) {
-                Vec3i nPos;
-                vec3i_add(&nPos, &pos, &vec3iFaceMap[face]);
-                Block* n = getBlock(&nPos);
-                if (!n || n->id == BLOCK_AIR) {
-                  block->neighbor[face] = false;
-                } else {
-                  block->neighbor[face] = true;
-                }
-              }
-            }
-
-            visibleCubes++;
-            // Blend block color with chunk color
-            Vec3 finalColor;
-            finalColor.x = blockColors[block->id].x * chunkColor.x;
-            finalColor.y = blockColors[block->id].y * chunkColor.y;
-            finalColor.z = blockColors[block->id].z * chunkColor.z;
-
-            Mat4 model;
-            mat4_identity(model);
-            model[12] = (float)pos.x + 0.5f;
-            model[13] = (float)pos.y + 0.5f;
-            model[14] = (float)pos.z + 0.5f;
-
-            glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, model);
-
-            glUseProgram(shaderProgram);
-
-            // Set the texture sampler uniform to use texture unit 0
-            glUniform1i(glGetUniformLocation(shaderProgram, "texture1"), 0);
-
-            // Bind the appropriate texture for each face
-            for (int face = 0; face < 6; face++) {
-              GLuint texture = 0;
-              if (block->neighbor[face]) {
-                continue;
-              }
-
-              switch (block->id) {
-              case BLOCK_STONE:
-                texture = stoneTexture;
-                break;
-              case BLOCK_DIRT:
-                texture = dirtTexture;
-                break;
-              case BLOCK_GRASS:
-                if (face == TOP) {
-                  texture = grassTopTexture;
-                } else if (face == BOTTOM) {
-                  texture = dirtTexture;
-                } else { // Side faces
-                  texture = grassSideTexture;
-                }
-                break;
-              }
-
-              renderCubeFace(face, texture);
-            }
-          }
+    if (softwareCulling) {
+      unsigned hidden = 0;
+      bool drawable = false;
+      for (int s = 0; s < CHUNK_SECTIONS; s++) {
+        if (!(sections >> s & 1) || chunk->meshes[s].vertexCount == 0) {
+          continue;
         }
+        Vec3 center, dimensions;
+        getSectionBounds(chunk, s, &center, &dimensions);
+        if (occluderBufferBoxVisible(&occluderBuffer, &center, &dimensions)) {
+          drawable = true;
+        } else {
+          hidden |= 1u << s;
+        }
+      }
+      sections &= ~hidden;
+      if (hidden && !drawable) {
+        softwareCulled++;
+        continue;
+      }
+    }
+
+    if (occlusionTested) {
+      OcclusionState occlusion = updateChunkOcclusion(chunk, &solidCenter, &solidDimensions, camera);
+      if (occlusion == OCCLUSION_HIDDEN) {
+        occlusionCulled++;
+        continue;
+      }
+      if (occlusion == OCCLUSION_PENDING) {
+        pendingDraws[pendingDrawCount++] = (ChunkDraw){chunk, sections};
+        continue;
       }
     }
+
+    // Meshes are built in the background, a dirty section keeps drawing its previous mesh until the new one is uploaded
+    queueChunkSections(chunk, sections, sectionOrder, &visibleCubes, &triangles);
   }
 
-  glBindVertexArray(0);
-  RenderResult result = {visibleCubes};
+  // The query issued two frames ago is read only once its result is available, so the GPU is never waited on.
+  // A query still in flight keeps the previous overdraw and is not issued again this frame.
+  int query = overdrawFrame++ & 1;
+  bool overdrawMeasured = true;
+  if (overdrawPixels[query] > 0) {
+    GLuint available;
+    glGetQueryObjectuiv(overdrawQueries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+      GLuint samples;
+      glGetQueryObjectuiv(overdrawQueries[query], GL_QUERY_RESULT, &samples);
+      overdraw = (float)samples / overdrawPixels[query];
+    } else {
+      overdrawMeasured = false;
+    }
+  }
+  if (overdrawMeasured) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    overdrawPixels[query] = viewport[2] * viewport[3];
+    glBeginQuery(GL_SAMPLES_PASSED, overdrawQueries[query]);
+  }
+
+  // One multi draw per render path, a frame can hold meshes of both paths while a path switch rebuilds them.
+  // Camera and light come from the frame uniforms, chunk origins from the mesh page table.
+  // Draws keep their queue order, so with sorting on the nearest chunks fill the depth buffer first.
+  for (int path = 0; path < RENDER_PATH_COUNT; path++) {
+    glUseProgram(chunkShaders[path].id);
+    chunkMeshDrawQueued(path);
+  }
+
+  // Chunks whose query result is still on its way are drawn one by one, the GPU skips them if the query saw nothing
+  for (int i = 0; i < pendingDrawCount; i++) {
+    queueChunkSections(pendingDraws[i].chunk, pendingDraws[i].sections, sectionOrder, &visibleCubes, &triangles);
+    glBeginConditionalRender(pendingDraws[i].chunk->occlusionQuery, GL_QUERY_WAIT);
+    for (int path = 0; path < RENDER_PATH_COUNT; path++) {
+      glUseProgram(chunkShaders[path].id);
+      chunkMeshDrawQueued(path);
+    }
+    glEndConditionalRender();
+  }
+  pendingDrawCount = 0;
+  if (overdrawMeasured) {
+    glEndQuery(GL_SAMPLES_PASSED);
+  }
+
+  // Tests run against the depth of everything drawn this frame, their results are read next frame
+  drawOcclusionTests();
+
+  RenderResult result = {visibleCubes, triangles, meshBuildCount ? (float)(meshBuildSeconds * 1000.0 / meshBuildCount) : 0.0f, chunkMeshGetArenaStats(), overdraw, frustumCulled, caveCulled, occlusionCulled, softwareCulled};
   return result;
 }
 void cleanupWorld() {
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteBuffers(1, &VBO);
-  glDeleteTextures(1, &stoneTexture);
-  glDeleteTextures(1, &dirtTexture);
-  glDeleteTextures(1, &grassTopTexture);
-  glDeleteTextures(1, &grassSideTexture);
+  glDeleteTextures(1, &blockTextures);
+  for (int path = 0; path < RENDER_PATH_COUNT; path++) {
+    destroyShaderProgram(&chunkShaders[path]);
+  }
+  glDeleteQueries(2, overdrawQueries);
+  destroyShaderProgram(&boundsShader);
+  glDeleteVertexArrays(1, &boundsVAO);
+  glDeleteBuffers(1, &boundsVBO);
+  free(occlusionTests);
+  free(pendingDraws);
+  occlusionTests = NULL;
+  pendingDraws = NULL;
+  occlusionCapacity = 0;
+  chunkMeshesCleanup();
 }
 
-// Get a pointer to the chunk at the given position.
+// Get a pointer to the chunk at the given chunk coordinates, NULL if it is not loaded or still generating.
 Chunk* getChunk(Vec2i* chunkPos) {
-  if (chunkPos->a < 0 || chunkPos->a >= CHUNKS_PER_AXIS || chunkPos->b < 0 || chunkPos->b >= CHUNKS_PER_AXIS) {
-    // printf("INVALID CHUNK PASSED pos: %d,%d\n", chunkPos->a, chunkPos->b);
-    return NULL;
+  Chunk* chunk = chunkMapGet(&chunks, chunkPos);
+  return chunk && chunk->state == CHUNK_READY ? chunk : NULL;
+}
+
+// Set the block at a world position and flag every section mesh that shows it for a rebuild: the section
+// holding it, the section above or below when it sits on a section boundary, and the same sections of a
+// neighbor chunk when it sits on a chunk border, or of the diagonal chunk as well on a chunk corner. Returns false when the position has no loaded chunk.
+bool setBlock(Vec3i* pos, enum BlockID id) {
+  if (pos->y < 0 || pos->y >= CHUNK_HEIGHT) {
+    return false;
+  }
+  Vec2i chunkPos = blockToChunk(pos);
+  Vec3i localPos = getLocal(pos);
+  Chunk* chunk = getChunk(&chunkPos);
+  if (!chunk) {
+    return false;
+  }
+  if (chunkGetBlock(chunk, localPos.x, pos->y, localPos.z) == id) {
+    return true;
+  }
+  chunkSetBlock(chunk, localPos.x, pos->y, localPos.z, id);
+
+  int s = pos->y / SECTION_HEIGHT;
+  int sectionY = pos->y % SECTION_HEIGHT;
+  unsigned sections = 1u << s;
+  if (sectionY == 0 && s > 0) {
+    sections |= 1u << (s - 1);
   }
-  return chunks[chunkPos->a][chunkPos->b];
+  if (sectionY == SECTION_HEIGHT - 1 && s < CHUNK_SECTIONS - 1) {
+    sections |= 1u << (s + 1);
+  }
+  markSectionsDirty(chunk, sections);
+
+  // A neighbor's border sections read the edited column too, so they are rebuilt over the same height range
+  for (int face = 0; face < 6; face++) {
+    int dx = vec3iFaceMap[face].x;
+    int dz = vec3iFaceMap[face].z;
+    bool onBorder = (dx < 0 && localPos.x == 0) || (dx > 0 && localPos.x == CHUNK_SIZE - 1) || (dz < 0 && localPos.z == 0) || (dz > 0 && localPos.z == CHUNK_SIZE - 1);
+    if (!onBorder) {
+      continue;
+    }
+    Vec2i neighborPos = {chunkPos.a + dx, chunkPos.b + dz};
+    Chunk* neighbor = getChunk(&neighborPos);
+    if (neighbor) {
+      markSectionsDirty(neighbor, sections);
+    }
+  }
+
+  // Ambient occlusion at a corner column also reads the diagonal chunk
+  bool cornerX = localPos.x == 0 || localPos.x == CHUNK_SIZE - 1;
+  bool cornerZ = localPos.z == 0 || localPos.z == CHUNK_SIZE - 1;
+  if (cornerX && cornerZ) {
+    Vec2i diagonalPos = {chunkPos.a + (localPos.x == 0 ? -1 : 1), chunkPos.b + (localPos.z == 0 ? -1 : 1)};
+    Chunk* diagonal = getChunk(&diagonalPos);
+    if (diagonal) {
+      markSectionsDirty(diagonal, sections);
+    }
+  }
+  return true;
 }
 
-// Get the block at the specified world position.
-Block* getBlock(Vec3i* pos) {
-  if (pos->y < 0 || pos->y > CHUNK_HEIGHT) {
-    return NULL;
+// Get the block at the specified world position, positions outside the world are air.
+enum BlockID getBlock(Vec3i* pos) {
+  if (pos->y < 0 || pos->y >= CHUNK_HEIGHT) {
+    return BLOCK_AIR;
   }
   Vec2i chunkPos = blockToChunk(pos);
   Vec3i localPos = getLocal(pos);
@@ -432,8 +1422,8 @@ Block* getBlock(Vec3i* pos) {
   Chunk* chunk = getChunk(&chunkPos);
   if (!chunk) {
     // printf("NULL CHUNK WHEN p: %d, %d, %d chunk: %d,%d\n", pos->x, pos->y, pos->z, chunkPos.a, chunkPos.b);
-    return NULL;
+    return BLOCK_AIR;
   }
 
-  return &chunk->blocks[localPos.x][pos->y][localPos.z];
+  return chunkGetBlock(chunk, localPos.x, pos->y, localPos.z);
 }
\ No newline at end of file
@@ -16,8 +16,10 @@
 #include "../math/math.h"
 #include "cube.h"
 #include "chunk.h"
+#include "mesher.h"
+#include "stream.h"
 
-#define WORLD_SIZE 256
+#define WORLD_SIZE 256 // Width of the chunk grid overlay, the world itself is unbounded
 #define WORLD_HEIGHT 64
 #define CUBE_SIZE 1.0f
 
@@ -25,8 +27,23 @@
 
 typedef struct {
   int visisbleCubes;
+  int triangles;       // Triangles in the drawn chunk meshes
+  float meshBuildTime; // Average milliseconds per mesh build in the current mesh mode, a build covers the dirty sections of one chunk
+  GpuArenaStats meshArena;
+  float overdraw; // Chunk fragments that passed the depth test per viewport pixel, from two frames ago
+  int frustumCulledChunks; // Chunks in render distance outside the view frustum
+  int caveCulledChunks;    // Chunks in the frustum with no section reached by the visibility walk
+  int occlusionCulledChunks; // Chunks whose bounding box query last frame had no visible sample
+  int softwareCulledChunks;  // Chunks whose sections are all behind the ground in the software depth buffer
 } RenderResult;
 
+// How far lattice sampled terrain is from full resolution terrain
+typedef struct {
+  float meanError;      // Mean absolute height difference in blocks
+  float maxError;       // Largest absolute height difference in blocks
+  float changedColumns; // Fraction of columns whose surface block moved
+} TerrainSampleError;
+
 typedef struct {
   float frequency;
   float amplitude;
@@ -35,17 +52,41 @@ typedef struct {
 } BiomeParameters;
 BiomeParameters getInterpolatedBiomeParameters(float x, float z);
 float getTerrainHeight(float x, float z);
+void getTerrainHeightGrid(const Vec2i* chunkPos, float heights[CHUNK_SIZE][CHUNK_SIZE]);
+void getTerrainHeightGridSampled(const Vec2i* chunkPos, int spacing, float heights[CHUNK_SIZE][CHUNK_SIZE]);
+TerrainSampleError measureTerrainSampleError(const Vec2i* center, int radius, int spacing);
+void setTerrainSampleSpacing(int spacing);
+int getTerrainSampleSpacing();
 const char* getCurrentBiomeText(float x, float z);
 // World Functions
 void initWorld();
-RenderResult renderWorld(GLuint shaderProgram, const Camera* camera);
+StreamStats updateWorld(const Camera* camera);
+void uploadFrameUniforms(const Camera* camera);
+RenderResult renderWorld(const Camera* camera);
+void setMeshMode(MeshMode mode);
+MeshMode getMeshMode();
+void setRenderPath(RenderPath path);
+RenderPath getRenderPath();
+void setChunkSorting(bool enabled);
+bool getChunkSorting();
+void setOcclusionCulling(bool enabled);
+bool getOcclusionCulling();
+void setSoftwareCulling(bool enabled);
+bool getSoftwareCulling();
+void setCaveCulling(bool enabled);
+bool getCaveCulling();
 void cleanupWorld();
 
 // Chunk functions
 void initChunks();
 void cleanupChunks();
-void renderChunkGrid(GLuint shaderProgram, const Camera* camera);
+void renderChunkGrid(const ShaderProgram* shaderProgram, const Camera* camera);
 
+Chunk* loadChunk(const Vec2i* chunkPos);
+void unloadChunk(Chunk* chunk);
+bool hasChunk(const Vec2i* chunkPos);
+Chunk* getNextChunk(int* iterator);
 Chunk* getChunk(Vec2i* chunkPos);
-Block* getBlock(Vec3i* pos);
+enum BlockID getBlock(Vec3i* pos);
+bool setBlock(Vec3i* pos, enum BlockID id);
 #endif // WORLD_H